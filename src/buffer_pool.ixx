@@ -0,0 +1,49 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module buffer_pool;
+
+import std;
+
+import storage_buffer;
+
+// Purpose: keeps released pixel buffers for reuse, which prevents allocating (and touching new pages of) a buffer
+// for every stripe or conversion. Buffers are uninitialized. Thread-safe: buffers can be released by worker threads.
+export class buffer_pool final
+{
+public:
+    // Returns a buffer of size bytes. Pixel buffers are requested with a few fixed sizes: only exact matches are reused.
+    [[nodiscard]]
+    storage_buffer acquire(const size_t size)
+    {
+        {
+            std::scoped_lock lock{mutex_};
+            if (const auto it{
+                    std::ranges::find_if(buffers_, [size](const storage_buffer& buffer) { return buffer.size() == size; })};
+                it != buffers_.end())
+            {
+                storage_buffer buffer{std::move(*it)};
+                buffers_.erase(it);
+                return buffer;
+            }
+        }
+
+        return storage_buffer{size};
+    }
+
+    void release(storage_buffer buffer)
+    {
+        std::scoped_lock lock{mutex_};
+        if (buffers_.size() == maximum_buffer_count)
+        {
+            buffers_.erase(buffers_.begin()); // Least recently released first.
+        }
+        buffers_.push_back(std::move(buffer));
+    }
+
+private:
+    static constexpr size_t maximum_buffer_count{4};
+
+    std::mutex mutex_;
+    std::vector<storage_buffer> buffers_;
+};
@@ -62,9 +62,10 @@ void register_general_decoder_encoder_settings(const GUID& class_id, const GUID&
 
 void register_decoder()
 {
-    constexpr array formats{&GUID_WICPixelFormat2bppGray,  &GUID_WICPixelFormat4bppGray, &GUID_WICPixelFormat8bppGray,
-                            &GUID_WICPixelFormat16bppGray, &GUID_WICPixelFormat24bppRGB, &GUID_WICPixelFormat32bppRGBA,
-                            &GUID_WICPixelFormat48bppRGB};
+    constexpr array formats{&GUID_WICPixelFormatBlackWhite, &GUID_WICPixelFormat2bppGray,  &GUID_WICPixelFormat4bppGray,
+                            &GUID_WICPixelFormat8bppGray,   &GUID_WICPixelFormat16bppGray, &GUID_WICPixelFormat24bppRGB,
+                            &GUID_WICPixelFormat32bppRGBA,  &GUID_WICPixelFormat48bppRGB,  &GUID_WICPixelFormat64bppRGBA,
+                            &GUID_WICPixelFormat8bppIndexed};
 
     register_general_decoder_encoder_settings(id::jpegls_decoder, CATID_WICBitmapDecoders, L"Team CharLS JPEG-LS Decoder",
                                               formats);
@@ -101,9 +102,11 @@ void register_decoder()
 
 void register_encoder()
 {
-    constexpr array formats{&GUID_WICPixelFormat2bppGray,  &GUID_WICPixelFormat4bppGray,  &GUID_WICPixelFormat8bppGray,
-                            &GUID_WICPixelFormat16bppGray, &GUID_WICPixelFormat24bppBGR,  &GUID_WICPixelFormat24bppRGB,
-                            &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppRGBA, &GUID_WICPixelFormat48bppRGB};
+    constexpr array formats{&GUID_WICPixelFormatBlackWhite, &GUID_WICPixelFormat2bppGray,  &GUID_WICPixelFormat4bppGray,
+                            &GUID_WICPixelFormat8bppGray,   &GUID_WICPixelFormat16bppGray, &GUID_WICPixelFormat24bppBGR,
+                            &GUID_WICPixelFormat24bppRGB,   &GUID_WICPixelFormat32bppBGRA, &GUID_WICPixelFormat32bppRGBA,
+                            &GUID_WICPixelFormat48bppRGB,   &GUID_WICPixelFormat64bppBGRA, &GUID_WICPixelFormat64bppRGBA,
+                            &GUID_WICPixelFormat8bppIndexed};
 
     register_general_decoder_encoder_settings(id::jpegls_encoder, CATID_WICBitmapEncoders, L"Team CharLS JPEG-LS Encoder",
                                               formats);
@@ -0,0 +1,193 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+module encoder_options;
+
+import std;
+import winrt_base;
+import charls;
+import <win.hpp>;
+
+import hresults;
+import util;
+
+using std::array;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint8_t;
+
+namespace {
+
+[[nodiscard]]
+PROPBAG2 make_description(const wchar_t* name, const VARTYPE type) noexcept
+{
+    PROPBAG2 description{};
+    description.dwType = PROPBAG2_TYPE_DATA;
+    description.vt = type;
+    description.pstrName = const_cast<LPOLESTR>(name);
+    return description;
+}
+
+// Returns no value when the option is not set.
+[[nodiscard]]
+std::optional<uint8_t> get_uint8(VARIANT& value)
+{
+    if (value.vt == VT_EMPTY)
+        return {};
+
+    check_condition(SUCCEEDED(VariantChangeType(&value, &value, 0, VT_UI1)), error_invalid_argument);
+    return value.bVal;
+}
+
+[[nodiscard]]
+std::optional<uint16_t> get_uint16(VARIANT& value)
+{
+    if (value.vt == VT_EMPTY)
+        return {};
+
+    check_condition(SUCCEEDED(VariantChangeType(&value, &value, 0, VT_UI2)), error_invalid_argument);
+    return value.uiVal;
+}
+
+[[nodiscard]]
+std::optional<uint32_t> get_uint32(VARIANT& value)
+{
+    if (value.vt == VT_EMPTY)
+        return {};
+
+    check_condition(SUCCEEDED(VariantChangeType(&value, &value, 0, VT_UI4)), error_invalid_argument);
+    return value.ulVal;
+}
+
+[[nodiscard]]
+std::optional<bool> get_bool(VARIANT& value)
+{
+    if (value.vt == VT_EMPTY)
+        return {};
+
+    check_condition(SUCCEEDED(VariantChangeType(&value, &value, 0, VT_BOOL)), error_invalid_argument);
+    return value.boolVal != VARIANT_FALSE;
+}
+
+// Owns the values returned by IPropertyBag2::Read.
+template<size_t Size>
+struct variants final
+{
+    variants() = default;
+    variants(const variants&) = delete;
+    variants& operator=(const variants&) = delete;
+
+    ~variants()
+    {
+        for (auto& value : values)
+        {
+            VariantClear(&value);
+        }
+    }
+
+    array<VARIANT, Size> values{};
+};
+
+} // namespace
+
+array<PROPBAG2, encoder_options::option_count> encoder_options::descriptions() noexcept
+{
+    return {make_description(encoder_option_name::near_lossless, VT_UI1),
+            make_description(encoder_option_name::interleave_mode, VT_UI1),
+            make_description(encoder_option_name::color_transformation, VT_UI1),
+            make_description(encoder_option_name::spiff_header, VT_BOOL),
+            make_description(encoder_option_name::auto_parameters, VT_BOOL),
+            make_description(encoder_option_name::target_size, VT_UI4),
+            make_description(encoder_option_name::restart_interval, VT_UI2),
+            make_description(encoder_option_name::significant_bits, VT_UI1),
+            make_description(encoder_option_name::auto_significant_bits, VT_BOOL),
+            make_description(encoder_option_name::reduce_components, VT_BOOL)};
+}
+
+encoder_options encoder_options::read(IPropertyBag2& property_bag)
+{
+    auto properties{descriptions()};
+    variants<option_count> values;
+    array<HRESULT, option_count> results{};
+    const HRESULT result{property_bag.Read(static_cast<ULONG>(properties.size()), properties.data(), nullptr,
+                                           values.values.data(), results.data())};
+
+    // Read fails when one of the properties can't be read: a missing property (property bags that are not created by
+    // CreateNewFrame) is not set, a property that can't be converted to its type is invalid.
+    bool property_failed{};
+    for (size_t i{}; i != option_count; ++i)
+    {
+        if (SUCCEEDED(results[i]))
+            continue;
+
+        check_condition(results[i] == wincodec::error_property_not_found, error_invalid_argument);
+        VariantClear(&values.values[i]);
+        property_failed = true;
+    }
+    if (!property_failed)
+    {
+        winrt::check_hresult(result);
+    }
+
+    encoder_options options;
+    if (const auto near_lossless{get_uint8(values.values[0])}; near_lossless)
+    {
+        options.near_lossless = *near_lossless;
+    }
+
+    if (const auto interleave_mode{get_uint8(values.values[1])}; interleave_mode)
+    {
+        check_condition(*interleave_mode <= 2, error_invalid_argument);
+        options.interleave_mode = static_cast<charls::interleave_mode>(*interleave_mode);
+    }
+
+    if (const auto color_transformation{get_uint8(values.values[2])}; color_transformation)
+    {
+        check_condition(*color_transformation <= 3, error_invalid_argument);
+        options.color_transformation = static_cast<charls::color_transformation>(*color_transformation);
+    }
+
+    if (const auto spiff_header{get_bool(values.values[3])}; spiff_header)
+    {
+        options.spiff_header = *spiff_header;
+    }
+
+    if (const auto auto_parameters{get_bool(values.values[4])}; auto_parameters)
+    {
+        options.auto_parameters = *auto_parameters;
+    }
+
+    if (const auto target_size{get_uint32(values.values[5])}; target_size)
+    {
+        options.target_size = *target_size;
+    }
+
+    if (const auto restart_interval{get_uint16(values.values[6])}; restart_interval)
+    {
+        options.restart_interval = *restart_interval;
+    }
+
+    if (const auto significant_bits{get_uint8(values.values[7])}; significant_bits)
+    {
+        // Less than 9 bits would change the pixel format of the decoded image (8 bit samples).
+        check_condition(*significant_bits == 0 || (*significant_bits >= 9 && *significant_bits <= 16),
+                        error_invalid_argument);
+        options.significant_bits = *significant_bits;
+    }
+
+    if (const auto auto_significant_bits{get_bool(values.values[8])}; auto_significant_bits)
+    {
+        options.auto_significant_bits = *auto_significant_bits;
+    }
+
+    if (const auto reduce_components{get_bool(values.values[9])}; reduce_components)
+    {
+        options.reduce_components = *reduce_components;
+    }
+
+    return options;
+}
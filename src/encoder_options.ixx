@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+export module encoder_options;
+
+import std;
+import charls;
+import <win.hpp>;
+
+using std::int32_t;
+
+// Names of the encoder options that can be set with the IPropertyBag2 returned by IWICBitmapEncoder::CreateNewFrame.
+export namespace encoder_option_name {
+
+inline constexpr const wchar_t* near_lossless{L"JpegLsNearLossless"};                // VT_UI1: 0 (lossless) - 255
+inline constexpr const wchar_t* interleave_mode{L"JpegLsInterleaveMode"};            // VT_UI1: 0 none, 1 line, 2 sample
+inline constexpr const wchar_t* color_transformation{L"JpegLsColorTransformation"};  // VT_UI1: 0 none, 1 HP1, 2 HP2, 3 HP3
+inline constexpr const wchar_t* spiff_header{L"JpegLsSpiffHeader"};                  // VT_BOOL
+inline constexpr const wchar_t* auto_parameters{L"JpegLsAutoParameters"};            // VT_BOOL
+inline constexpr const wchar_t* target_size{L"JpegLsTargetSize"};                    // VT_UI4: bytes, 0 (no target)
+inline constexpr const wchar_t* restart_interval{L"JpegLsRestartInterval"};          // VT_UI2: lines, 0 (none)
+inline constexpr const wchar_t* significant_bits{L"JpegLsSignificantBits"};          // VT_UI1: 0 (all), 9 - 16
+inline constexpr const wchar_t* auto_significant_bits{L"JpegLsAutoSignificantBits"}; // VT_BOOL
+inline constexpr const wchar_t* reduce_components{L"JpegLsReduceComponents"};        // VT_BOOL
+
+} // namespace encoder_option_name
+
+export struct encoder_options final
+{
+    int32_t near_lossless{};
+
+    // No value: sample interleave for images with multiple components.
+    std::optional<charls::interleave_mode> interleave_mode;
+
+    // Note: only applied to images with 3 components, the color transformations are defined for RGB.
+    charls::color_transformation color_transformation{charls::color_transformation::none};
+
+    // Note: without a SPIFF header the resolution (SetResolution) is not stored.
+    bool spiff_header{true};
+
+    // Selects the interleave mode, color transformation and preset coding parameters by trial-encoding sampled
+    // lines of the image; overrides the interleave mode and color transformation options.
+    bool auto_parameters{};
+
+    // Selects the smallest NEAR value for which the estimated encoded size fits in the target size (in bytes);
+    // overrides the near-lossless option. 0: no target size.
+    std::uint32_t target_size{};
+
+    // Number of lines between restart markers, 0: no restart markers. The stripes between the restart markers are
+    // encoded concurrently. Requires an interleaved scan for images with multiple components.
+    std::uint32_t restart_interval{};
+
+    // Number of significant bits of the samples of 16 bit pixel formats, 0: all 16 bits. The samples are stored
+    // left-aligned (the layout returned by the decoder), they are shifted right and encoded with this bit depth.
+    std::int32_t significant_bits{};
+
+    // Detects the significant bits of the samples of 16 bit pixel formats while the pixels are copied: left-aligned
+    // samples (unused low bits) are shifted right, right-aligned samples (unused high bits) are encoded with the bit
+    // depth of the largest sample and marked, the decoder returns them unshifted. Ignored when the significant bits are
+    // set and in streaming mode (WICBitmapEncoderNoCache), which encodes the first lines before all samples are known.
+    bool auto_significant_bits{};
+
+    // Detects redundant components of 8 bit RGB(A) pixels while the pixels are copied: opaque (constant alpha) RGBA
+    // images are encoded as RGB, neutral (R == G == B) images as gray. The decoder restores the source pixel format.
+    // Ignored in streaming mode (WICBitmapEncoderNoCache).
+    bool reduce_components{};
+
+    // The parameters are selected by trial-encoding sampled lines of the image.
+    [[nodiscard]]
+    bool select_parameters() const noexcept
+    {
+        return auto_parameters || target_size != 0;
+    }
+
+    static constexpr size_t option_count{10};
+
+    // Returns the descriptions of the options, used to create the encoder property bag.
+    [[nodiscard]]
+    static std::array<PROPBAG2, option_count> descriptions() noexcept;
+
+    // Reads the options that are set in the property bag; options that are not set keep their default value.
+    // Throws error_invalid_argument for values that are out of range.
+    [[nodiscard]]
+    static encoder_options read(IPropertyBag2& property_bag);
+};
@@ -0,0 +1,152 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+export module header_cache;
+
+import std;
+import winrt_base;
+import charls;
+import <win.hpp>;
+
+using std::int64_t;
+using std::uint64_t;
+
+// Parsed JPEG-LS header information, looked up by the decoder (QueryCapability) and the property store.
+// The frame decoder parses the header itself (CharLS needs it to decode) and only stores it.
+export struct header_info final
+{
+    charls::frame_info frame_info;
+    std::optional<charls::spiff_header> spiff_header;
+    charls::interleave_mode interleave_mode;
+
+    // Note: the decoder must have read the SPIFF header (if present) and the JPEG-LS header.
+    [[nodiscard]]
+    static header_info from(const charls::jpegls_decoder& decoder)
+    {
+        return {.frame_info{decoder.frame_info()},
+                .spiff_header{decoder.spiff_header_has_value() ? std::optional{decoder.spiff_header()} : std::nullopt},
+                .interleave_mode{decoder.get_interleave_mode()}};
+    }
+};
+
+namespace {
+
+constexpr size_t leading_byte_count{64};
+constexpr size_t maximum_entry_count{8};
+
+struct stream_identity final
+{
+    std::wstring name;
+    uint64_t size;
+    uint64_t last_write_time;
+
+    [[nodiscard]]
+    bool operator==(const stream_identity&) const = default;
+};
+
+struct cache_entry final
+{
+    stream_identity identity;
+    std::vector<std::byte> leading_bytes;
+    header_info info;
+};
+
+std::mutex mutex;
+std::vector<cache_entry> entries; // Most recently used entry first.
+
+// Streams without a name (memory streams, custom streams) have no cheap identity and are not cached.
+[[nodiscard]]
+std::optional<stream_identity> get_stream_identity(IStream& stream)
+{
+    STATSTG stat{};
+    if (FAILED(stream.Stat(&stat, STATFLAG_DEFAULT)))
+        return {};
+
+    const std::unique_ptr<wchar_t, decltype(&CoTaskMemFree)> name{stat.pwcsName, &CoTaskMemFree};
+    if (!name)
+        return {};
+
+    return stream_identity{.name{name.get()},
+                           .size{stat.cbSize.QuadPart},
+                           .last_write_time{(static_cast<uint64_t>(stat.mtime.dwHighDateTime) << 32) |
+                                            stat.mtime.dwLowDateTime}};
+}
+
+// Reads the leading bytes from the current position and restores the position afterwards.
+[[nodiscard]]
+std::vector<std::byte> peek_leading_bytes(IStream& stream)
+{
+    std::vector<std::byte> leading_bytes(leading_byte_count);
+    unsigned long read_byte_count;
+    winrt::check_hresult(stream.Read(leading_bytes.data(), static_cast<ULONG>(leading_bytes.size()), &read_byte_count));
+
+    LARGE_INTEGER offset;
+    offset.QuadPart = -static_cast<int64_t>(read_byte_count);
+    winrt::check_hresult(stream.Seek(offset, STREAM_SEEK_CUR, nullptr));
+
+    leading_bytes.resize(read_byte_count);
+    return leading_bytes;
+}
+
+} // namespace
+
+export namespace header_cache {
+
+// Purpose: returns the cached header information when the stream identity, size and leading bytes match.
+// The cache is an optimization: any failure to identify the stream is reported as a cache miss.
+[[nodiscard]]
+std::optional<header_info> find(IStream& stream) noexcept
+try
+{
+    const auto identity{get_stream_identity(stream)};
+    if (!identity)
+        return {};
+
+    const auto leading_bytes{peek_leading_bytes(stream)};
+
+    std::scoped_lock lock{mutex};
+    const auto it{std::ranges::find_if(entries, [&](const cache_entry& entry) {
+        return entry.identity == *identity && std::ranges::equal(entry.leading_bytes, leading_bytes);
+    })};
+    if (it == entries.end())
+        return {};
+
+    std::ranges::rotate(entries.begin(), it, it + 1);
+    return entries.front().info;
+}
+catch (...)
+{
+    return {};
+}
+
+// Purpose: stores the header information of a stream, the leading bytes are taken from the already read content.
+void insert(IStream& stream, const std::span<const std::byte> content, const header_info& info) noexcept
+try
+{
+    auto identity{get_stream_identity(stream)};
+    if (!identity)
+        return;
+
+    cache_entry entry{.identity{std::move(*identity)},
+                      .leading_bytes{content.begin(), content.begin() + std::min(content.size(), leading_byte_count)},
+                      .info{info}};
+
+    std::scoped_lock lock{mutex};
+    std::erase_if(entries, [&](const cache_entry& existing) { return existing.identity == entry.identity; });
+    if (entries.size() == maximum_entry_count)
+    {
+        entries.pop_back();
+    }
+
+    entries.insert(entries.begin(), std::move(entry));
+}
+catch (...)
+{
+    // Failing to cache is not an error.
+}
+
+} // namespace header_cache
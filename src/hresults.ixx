@@ -21,6 +21,7 @@ inline constexpr HRESULT error_class_not_available{CLASS_E_CLASSNOTAVAILABLE};
 inline constexpr HRESULT error_out_of_memory{E_OUTOFMEMORY};
 inline constexpr HRESULT error_invalid_argument{E_INVALIDARG};
 inline constexpr HRESULT error_access_denied{STG_E_ACCESSDENIED};
+inline constexpr HRESULT error_medium_full{STG_E_MEDIUMFULL};
 inline constexpr HRESULT error_not_valid_state{E_NOT_VALID_STATE};
 
 namespace wincodec {
@@ -36,6 +37,9 @@ inline constexpr HRESULT error_codec_too_many_scan_lines{WINCODEC_ERR_CODECTOOMA
 inline constexpr HRESULT error_component_not_found{WINCODEC_ERR_COMPONENTNOTFOUND};
 inline constexpr HRESULT error_bad_header{WINCODEC_ERR_BADHEADER};
 inline constexpr HRESULT error_bad_image{WINCODEC_ERR_BADIMAGE};
+inline constexpr HRESULT error_insufficient_buffer{WINCODEC_ERR_INSUFFICIENTBUFFER};
+inline constexpr HRESULT error_already_locked{WINCODEC_ERR_ALREADYLOCKED};
+inline constexpr HRESULT error_property_not_found{WINCODEC_ERR_PROPERTYNOTFOUND};
 
 } // namespace wincodec
 
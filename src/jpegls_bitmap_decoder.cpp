@@ -14,6 +14,7 @@ import <win.hpp>;
 
 import class_factory;
 import guids;
+import header_cache;
 import util;
 import hresults;
 import jpegls_bitmap_frame_decode;
@@ -49,28 +50,40 @@ struct jpegls_bitmap_decoder : winrt::implements<jpegls_bitmap_decoder, IWICBitm
         // Custom decoder implementations should save the current position of the specified IStream,
         // read whatever information is necessary in order to determine which capabilities
         // it can provide for the supplied stream, and restore the stream position.
-        array<std::byte, static_cast<size_t>(4) * 1024> header{};
-        unsigned long read_byte_count;
-
-        check_hresult(stream->Read(header.data(), static_cast<ULONG>(header.size()), &read_byte_count));
-
-        LARGE_INTEGER offset;
-        offset.QuadPart = -static_cast<int64_t>(read_byte_count);
-        check_hresult(stream->Seek(offset, STREAM_SEEK_CUR, nullptr));
-
-        jpegls_decoder decoder;
-        decoder.source(header.data(), read_byte_count);
-
-        error_code error;
-        decoder.read_header(error);
-        if (error)
+        auto info{header_cache::find(*stream)};
+        if (!info)
         {
-            TRACE("{} jpegls_bitmap_decoder::QueryCapability.2, capability=0, ec={}, (reason={})\n", fmt::ptr(this),
-                  error.value(), jpegls_category().message(error.value()));
-            return success_ok;
+            array<std::byte, static_cast<size_t>(4) * 1024> header{};
+            unsigned long read_byte_count;
+
+            check_hresult(stream->Read(header.data(), static_cast<ULONG>(header.size()), &read_byte_count));
+
+            LARGE_INTEGER offset;
+            offset.QuadPart = -static_cast<int64_t>(read_byte_count);
+            check_hresult(stream->Seek(offset, STREAM_SEEK_CUR, nullptr));
+
+            jpegls_decoder decoder;
+            decoder.source(header.data(), read_byte_count);
+
+            error_code error;
+            decoder.read_spiff_header(error);
+            if (!error)
+            {
+                decoder.read_header(error);
+            }
+
+            if (error)
+            {
+                TRACE("{} jpegls_bitmap_decoder::QueryCapability.2, capability=0, ec={}, (reason={})\n", fmt::ptr(this),
+                      error.value(), jpegls_category().message(error.value()));
+                return success_ok;
+            }
+
+            info = header_info::from(decoder);
+            header_cache::insert(*stream, std::span{header.data(), read_byte_count}, *info);
         }
 
-        if (const auto& [width, height, bits_per_sample, component_count]{decoder.frame_info()};
+        if (const auto& [width, height, bits_per_sample, component_count]{info->frame_info};
             jpegls_bitmap_frame_decode::can_decode_to_wic_pixel_format(bits_per_sample, component_count))
         {
             *capability = WICBitmapDecoderCapabilityCanDecodeAllImages;
@@ -85,8 +98,7 @@ struct jpegls_bitmap_decoder : winrt::implements<jpegls_bitmap_decoder, IWICBitm
         return to_hresult();
     }
 
-    HRESULT __stdcall Initialize(_In_ IStream* stream, [[maybe_unused]]
-                                                       const WICDecodeOptions cache_options) noexcept override
+    HRESULT __stdcall Initialize(_In_ IStream* stream, const WICDecodeOptions cache_options) noexcept override
     try
     {
         TRACE("{} jpegls_bitmap_decoder::Initialize, stream={}, cache_options={}\n", fmt::ptr(this), fmt::ptr(stream),
@@ -95,6 +107,7 @@ struct jpegls_bitmap_decoder : winrt::implements<jpegls_bitmap_decoder, IWICBitm
         scoped_lock lock{mutex_};
 
         source_stream_.copy_from(check_in_pointer(stream));
+        cache_options_ = cache_options;
         bitmap_frame_decode_.attach(nullptr);
 
         return success_ok;
@@ -209,7 +222,7 @@ struct jpegls_bitmap_decoder : winrt::implements<jpegls_bitmap_decoder, IWICBitm
 
         if (!bitmap_frame_decode_)
         {
-            bitmap_frame_decode_ = make<jpegls_bitmap_frame_decode>(source_stream_.get(), imaging_factory());
+            bitmap_frame_decode_ = make<jpegls_bitmap_frame_decode>(source_stream_.get(), imaging_factory(), cache_options_);
         }
 
         bitmap_frame_decode_.copy_to(check_out_pointer(bitmap_frame_decode));
@@ -235,6 +248,7 @@ struct jpegls_bitmap_decoder : winrt::implements<jpegls_bitmap_decoder, IWICBitm
     std::mutex mutex_;
     com_ptr<IWICImagingFactory> imaging_factory_;
     com_ptr<IStream> source_stream_;
+    WICDecodeOptions cache_options_{WICDecodeMetadataCacheOnLoad};
     com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode_;
 };
 
@@ -13,18 +13,15 @@ import charls;
 import <win.hpp>;
 
 import class_factory;
+import encoder_options;
 import guids;
 import hresults;
 import jpegls_bitmap_frame_encode;
+import stripe_encoder;
 import util;
 import "macros.hpp";
 
-using charls::interleave_mode;
-using charls::jpegls_encoder;
-using charls::spiff_color_space;
-using charls::spiff_resolution_units;
 using std::uint32_t;
-using std::vector;
 using winrt::check_hresult;
 using winrt::com_ptr;
 using winrt::implements;
@@ -32,44 +29,10 @@ using winrt::make;
 
 namespace {
 
-[[nodiscard]]
-spiff_color_space determine_spiff_color_space(const uint32_t component_count) noexcept
-{
-    using enum spiff_color_space;
-    switch (component_count)
-    {
-    case 1:
-        return grayscale;
-    case 3:
-        return rgb;
-    case 4:
-        return none; // SPIFF has no defined color space for RGBA.
-
-    default:
-        std::unreachable();
-    }
-}
-
-void write_spiff_header(jpegls_encoder& encoder, const jpegls_bitmap_frame_encode& bitmap_frame_encode)
-{
-    const auto color_space{determine_spiff_color_space(bitmap_frame_encode.frame_info().component_count)};
-
-    if (const auto& resolution{bitmap_frame_encode.resolution()}; resolution.has_value())
-    {
-        encoder.write_standard_spiff_header(color_space, spiff_resolution_units::dots_per_inch, resolution->second,
-                                            resolution->first);
-    }
-    else
-    {
-        encoder.write_standard_spiff_header(color_space);
-    }
-}
-
 struct jpegls_bitmap_encoder : implements<jpegls_bitmap_encoder, IWICBitmapEncoder>
 {
     // IWICBitmapEncoder
-    HRESULT __stdcall Initialize(_In_ IStream* destination, [[maybe_unused]]
-                                                            const WICBitmapEncoderCacheOption cache_option) noexcept override
+    HRESULT __stdcall Initialize(_In_ IStream* destination, const WICBitmapEncoderCacheOption cache_option) noexcept override
     try
     {
         TRACE("{} jpegls_bitmap_encoder::Initialize, stream={}, cache_option={}\n", fmt::ptr(this), fmt::ptr(destination),
@@ -77,6 +40,7 @@ struct jpegls_bitmap_encoder : implements<jpegls_bitmap_encoder, IWICBitmapEncod
 
         check_condition(!static_cast<bool>(destination_), wincodec::error_wrong_state);
         destination_.copy_from(check_in_pointer(destination));
+        cache_option_ = cache_option;
         return success_ok;
     }
     catch (...)
@@ -124,14 +88,20 @@ struct jpegls_bitmap_encoder : implements<jpegls_bitmap_encoder, IWICBitmapEncod
         check_condition(static_cast<bool>(destination_), wincodec::error_not_initialized);
         check_condition(!static_cast<bool>(bitmap_frame_encode_), wincodec::error_wrong_state); // Only 1 frame is supported.
 
-        bitmap_frame_encode_ = winrt::make_self<jpegls_bitmap_frame_encode>();
+        com_ptr<IPropertyBag2> options;
+        if (encoder_options)
+        {
+            options = create_encoder_options();
+        }
+
+        bitmap_frame_encode_ = winrt::make_self<jpegls_bitmap_frame_encode>(destination_.get(), cache_option_);
 
         *check_out_pointer(bitmap_frame_encode) = bitmap_frame_encode_.get();
         (*bitmap_frame_encode)->AddRef();
 
         if (encoder_options)
         {
-            *encoder_options = nullptr;
+            *encoder_options = options.detach();
         }
 
         return success_ok;
@@ -150,23 +120,32 @@ struct jpegls_bitmap_encoder : implements<jpegls_bitmap_encoder, IWICBitmapEncod
         check_condition(static_cast<bool>(destination_), wincodec::error_not_initialized);
         check_condition(static_cast<bool>(bitmap_frame_encode_), wincodec::error_frame_missing);
 
-        jpegls_encoder encoder;
-        encoder.frame_info(bitmap_frame_encode_->frame_info());
-
-        vector<std::byte> destination(encoder.estimated_destination_size());
-        encoder.destination(destination);
-
-        if (bitmap_frame_encode_->frame_info().component_count > 1)
+        // Note: in streaming mode (WICBitmapEncoderNoCache) the frame has already written the encoded data.
+        if (!bitmap_frame_encode_->streamed())
         {
-            encoder.interleave_mode(interleave_mode::sample);
+            const auto parameters{bitmap_frame_encode_->parameters()};
+            if (const uint32_t restart_interval{bitmap_frame_encode_->restart_interval()}; restart_interval != 0)
+            {
+                // The completed stripes are written while the next stripes are encoded.
+                const stripe_encoder encoder{parameters, restart_interval};
+                encoder.encode_stripes(
+                    bitmap_frame_encode_->source(), bitmap_frame_encode_->source_stride(),
+                    [this](const encoded_data& stripe) { write_to_stream(*destination_, stripe.bytes()); });
+
+                write_to_stream(*destination_, stripe_encoder::end_of_image());
+            }
+            else
+            {
+                // Without restart intervals the image is 1 scan: it is written after it is encoded completely.
+                const auto encoded{encode(parameters, parameters.frame_info.height, bitmap_frame_encode_->source(),
+                                          bitmap_frame_encode_->source_stride())};
+                write_to_stream(*destination_, encoded.bytes());
+            }
+
+            bitmap_frame_encode_->release_source();
         }
 
-        write_spiff_header(encoder, *bitmap_frame_encode_.get());
-
-        const auto bytes_written{encoder.encode(bitmap_frame_encode_->source(), bitmap_frame_encode_->source_stride())};
         bitmap_frame_encode_ = nullptr;
-
-        check_hresult(destination_->Write(destination.data(), static_cast<ULONG>(bytes_written), nullptr));
         check_hresult(destination_->Commit(STGC_DEFAULT));
         destination_ = nullptr;
 
@@ -227,6 +206,20 @@ struct jpegls_bitmap_encoder : implements<jpegls_bitmap_encoder, IWICBitmapEncod
     }
 
 private:
+    // The caller can set the options in the property bag and pass it to IWICBitmapFrameEncode::Initialize.
+    [[nodiscard]]
+    com_ptr<IPropertyBag2> create_encoder_options()
+    {
+        com_ptr<IWICComponentFactory> component_factory;
+        check_hresult(imaging_factory()->QueryInterface(IID_PPV_ARGS(component_factory.put())));
+
+        auto descriptions{encoder_options::descriptions()};
+        com_ptr<IPropertyBag2> property_bag;
+        check_hresult(component_factory->CreateEncoderPropertyBag(
+            descriptions.data(), static_cast<uint32_t>(descriptions.size()), property_bag.put()));
+        return property_bag;
+    }
+
     [[nodiscard]]
     IWICImagingFactory* imaging_factory()
     {
@@ -242,6 +235,7 @@ struct jpegls_bitmap_encoder : implements<jpegls_bitmap_encoder, IWICBitmapEncod
     bool committed_{};
     com_ptr<IWICImagingFactory> imaging_factory_;
     com_ptr<IStream> destination_;
+    WICBitmapEncoderCacheOption cache_option_{WICBitmapEncoderCacheInMemory};
     com_ptr<jpegls_bitmap_frame_encode> bitmap_frame_encode_;
 };
 
@@ -12,9 +12,14 @@ import winrt_base;
 import charls;
 import <win.hpp>;
 
+import header_cache;
 import util;
 import hresults;
+import original_components;
+import pixel_conversion;
+import right_aligned_samples;
 import storage_buffer;
+import stream_memory;
 import "macros.hpp";
 
 using namespace charls;
@@ -37,6 +42,9 @@ std::optional<std::pair<GUID, uint32_t>> get_pixel_format(const int32_t bits_per
     case 1:
         switch (bits_per_sample)
         {
+        case 1:
+            return make_pair(GUID_WICPixelFormatBlackWhite, 0);
+
         case 2:
             return make_pair(GUID_WICPixelFormat2bppGray, 0);
 
@@ -46,26 +54,29 @@ std::optional<std::pair<GUID, uint32_t>> get_pixel_format(const int32_t bits_per
         case 8:
             return make_pair(GUID_WICPixelFormat8bppGray, 0);
 
-        case 10:
-        case 12:
-        case 16:
-            return make_pair(GUID_WICPixelFormat16bppGray, 16 - bits_per_sample);
-
         default:
+            // Samples with 9 to 15 bits are shifted to the most significant bits of the 16 bit pixel format.
+            if (bits_per_sample > 8 && bits_per_sample <= 16)
+                return make_pair(GUID_WICPixelFormat16bppGray, 16 - bits_per_sample);
             break;
         }
         break;
 
+    case 2:
+        // Gray + alpha has no native WIC pixel format: the gray samples are replicated to RGB.
+        if (bits_per_sample == 8)
+            return make_pair(GUID_WICPixelFormat32bppRGBA, 0);
+        break;
+
     case 3:
         switch (bits_per_sample)
         {
         case 8:
             return make_pair(GUID_WICPixelFormat24bppRGB, 0);
 
-        case 16:
-            return make_pair(GUID_WICPixelFormat48bppRGB, 0);
-
         default:
+            if (bits_per_sample > 8 && bits_per_sample <= 16)
+                return make_pair(GUID_WICPixelFormat48bppRGB, 16 - bits_per_sample);
             break;
         }
         break;
@@ -77,6 +88,8 @@ std::optional<std::pair<GUID, uint32_t>> get_pixel_format(const int32_t bits_per
             return make_pair(GUID_WICPixelFormat32bppRGBA, 0);
 
         default:
+            if (bits_per_sample > 8 && bits_per_sample <= 16)
+                return make_pair(GUID_WICPixelFormat64bppRGBA, 16 - bits_per_sample);
             break;
         }
         break;
@@ -88,6 +101,28 @@ std::optional<std::pair<GUID, uint32_t>> get_pixel_format(const int32_t bits_per
     return {};
 }
 
+void pack_to_bits(const std::span<const std::byte> byte_pixels, std::byte* bit_pixels, const size_t width,
+                  const size_t height, const size_t stride) noexcept
+{
+    for (size_t row{}; row != height; ++row)
+    {
+        const std::byte* samples{byte_pixels.data() + (row * width)};
+        std::byte* bit_row{bit_pixels + (row * stride)};
+        const size_t i{width / 8};
+        pack_bits(samples, bit_row, i);
+
+        if (width % 8)
+        {
+            std::byte value{};
+            for (size_t bit{}; bit != width % 8; ++bit)
+            {
+                value |= samples[(i * 8) + bit] << (7 - bit);
+            }
+            bit_row[i] = value;
+        }
+    }
+}
+
 void pack_to_crumbs(const std::span<const std::byte> byte_pixels, std::byte* crumb_pixels, const size_t width,
                     const size_t height, const size_t stride) noexcept
 {
@@ -144,61 +179,55 @@ void pack_to_nibbles(const std::span<const std::byte> byte_pixels, std::byte* ni
     }
 }
 
-#ifndef NDEBUG
-[[nodiscard]]
-uint32_t compute_minimal_stride(const frame_info& frame_info) noexcept
+// Restores the components of the source pixel format of an image with removed components: gray => RGB(A), RGB => RGBA.
+void restore_components(const std::byte* source, std::byte* destination, const size_t pixel_count,
+                        const size_t component_count, const original_components& source_components) noexcept
 {
-    if (frame_info.bits_per_sample == 2)
+    const auto restored_count{static_cast<size_t>(source_components.component_count)};
+    const size_t green{component_count == 1 ? 0U : 1U};
+    const size_t blue{component_count == 1 ? 0U : 2U};
+    for (size_t i{}; i != pixel_count; ++i)
     {
-        const uint32_t stride{(frame_info.width + 3) / 4 * frame_info.component_count};
-        return ((stride + 3) / 4) * 4;
-    }
-
-    uint32_t stride{frame_info.width * ((frame_info.bits_per_sample + 7) / 8) * frame_info.component_count};
-    if (frame_info.bits_per_sample < 8)
-    {
-        stride /= 2;
+        const std::byte* pixel{source + (i * component_count)};
+        std::byte* restored{destination + (i * restored_count)};
+        restored[0] = pixel[0];
+        restored[1] = pixel[green];
+        restored[2] = pixel[blue];
+        if (restored_count == 4)
+        {
+            restored[3] = source_components.alpha;
+        }
     }
-
-    return stride;
-}
-#endif
-
-void shift_samples(void* buffer, const size_t pixel_count, const uint32_t sample_shift)
-{
-    auto* const pixels{static_cast<uint16_t*>(buffer)};
-    std::transform(pixels, pixels + pixel_count, pixels, [sample_shift](const uint16_t pixel) {
-        return static_cast<uint16_t>(pixel << sample_shift);
-    });
 }
 
+// Samples with fewer bits than the pixel format are shifted to its most significant bits while they are interleaved.
 template<typename SizeType>
-void convert_planar_to_rgb(const size_t width, const size_t height, const void* source, void* destination,
-                           const size_t destination_stride) noexcept
+void convert_planar_to_interleaved(const size_t width, const size_t height, const size_t component_count,
+                                   const void* source, void* destination, const size_t destination_stride,
+                                   const uint32_t sample_shift) noexcept
 {
-    const auto* r{static_cast<const SizeType*>(source)};
-    const auto* g{static_cast<const SizeType*>(source) + (width * height)};
-    const auto* b{static_cast<const SizeType*>(source) + (width * height * 2)};
+    const auto* planes{static_cast<const SizeType*>(source)};
+    const size_t plane_size{width * height};
 
-    auto* rgb{static_cast<SizeType*>(destination)};
+    auto* pixels{static_cast<SizeType*>(destination)};
 
     for (size_t row{}; row != height; ++row)
     {
-        for (size_t col{}, offset = 0; col != width; ++col, offset += 3)
+        for (size_t component{}; component != component_count; ++component)
         {
-            rgb[offset + 0] = r[col];
-            rgb[offset + 1] = g[col];
-            rgb[offset + 2] = b[col];
+            const SizeType* plane_row{planes + (component * plane_size) + (row * width)};
+            for (size_t col{}, offset = component; col != width; ++col, offset += component_count)
+            {
+                pixels[offset] = static_cast<SizeType>(plane_row[col] << sample_shift);
+            }
         }
 
-        b += width;
-        g += width;
-        r += width;
-        rgb += destination_stride / sizeof(SizeType);
+        pixels += destination_stride / sizeof(SizeType);
     }
 }
 
-void set_resolution(const jpegls_decoder& decoder, IWICBitmap& bitmap)
+[[nodiscard]]
+std::pair<double, double> get_resolution(const jpegls_decoder& decoder)
 {
     if (decoder.spiff_header_has_value())
     {
@@ -213,151 +242,429 @@ void set_resolution(const jpegls_decoder& decoder, IWICBitmap& bitmap)
 
             case dots_per_centimeter: {
                 constexpr double dpc_to_dpi{2.54};
-                check_hresult(bitmap.SetResolution(std::round(spiff_header.horizontal_resolution * dpc_to_dpi),
-                                                   std::round(spiff_header.vertical_resolution * dpc_to_dpi)));
-                return;
+                return {std::round(spiff_header.horizontal_resolution * dpc_to_dpi),
+                        std::round(spiff_header.vertical_resolution * dpc_to_dpi)};
             }
 
             case dots_per_inch:
-                check_hresult(bitmap.SetResolution(spiff_header.horizontal_resolution, spiff_header.vertical_resolution));
-                return;
+                return {spiff_header.horizontal_resolution, spiff_header.vertical_resolution};
+            }
+        }
+    }
+
+    return {96, 96};
+}
+
+// Returns the palette of an 8 bit single component image with a mapping table (RGB or RGBA entries), empty when the
+// image has no (usable) palette.
+// Note: the table ID of the scan is only known after decoding, an image with 1 mapping table is assumed to use it.
+[[nodiscard]]
+vector<WICColor> read_palette(const jpegls_decoder& decoder)
+{
+    if (const auto& frame_info{decoder.frame_info()};
+        frame_info.component_count != 1 || frame_info.bits_per_sample != 8 || decoder.mapping_table_count() != 1)
+        return {};
+
+    const auto table_info{decoder.get_mapping_table_info(0)};
+    const auto entry_size{static_cast<size_t>(table_info.entry_size)};
+    if ((entry_size != 3 && entry_size != 4) || table_info.data_size % entry_size != 0 ||
+        table_info.data_size / entry_size == 0 || table_info.data_size / entry_size > 256)
+        return {};
+
+    vector<std::byte> entries(table_info.data_size);
+    decoder.get_mapping_table_data(0, entries.data(), entries.size());
+
+    vector<WICColor> palette(entries.size() / entry_size);
+    for (size_t i{}; i != palette.size(); ++i)
+    {
+        const std::byte* entry{entries.data() + (i * entry_size)};
+        const uint32_t alpha{entry_size == 4 ? std::to_integer<uint32_t>(entry[3]) : 0xFFU};
+        palette[i] = (alpha << 24) | (std::to_integer<uint32_t>(entry[0]) << 16) |
+                     (std::to_integer<uint32_t>(entry[1]) << 8) | std::to_integer<uint32_t>(entry[2]);
+    }
+
+    return palette;
+}
+
+[[nodiscard]]
+uint32_t compute_bits_per_pixel(const frame_info& frame_info) noexcept
+{
+    return (frame_info.bits_per_sample <= 8 ? frame_info.bits_per_sample : 16) * frame_info.component_count;
+}
+
+// Windows bitmaps are always DWORD (4 bytes) aligned per scan line.
+[[nodiscard]]
+uint32_t compute_stride(const frame_info& frame_info) noexcept
+{
+    const uint32_t stride{((frame_info.width * compute_bits_per_pixel(frame_info)) + 7) / 8};
+    constexpr uint32_t alignment{4};
+    return ((stride + (alignment - 1)) / alignment) * alignment;
+}
+
+// Decodes the pixels with the encoded components.
+// Note: the 2 bit samples of bilevel images (MAXVAL 1) are packed to 1 bit per pixel.
+void decode_encoded_components(jpegls_decoder& decoder, const uint32_t sample_shift, const bool bilevel,
+                               std::byte* destination, const size_t destination_size, const uint32_t stride)
+{
+    const auto& frame_info{decoder.frame_info()};
+
+    try
+    {
+        if (frame_info.component_count != 1 && decoder.get_interleave_mode() == interleave_mode::none)
+        {
+            const auto planar{decoder.decode<vector<std::byte>>()};
+            if (frame_info.bits_per_sample > 8)
+            {
+                convert_planar_to_interleaved<uint16_t>(frame_info.width, frame_info.height, frame_info.component_count,
+                                                        planar.data(), destination, stride, sample_shift);
+            }
+            else
+            {
+                convert_planar_to_interleaved<std::byte>(frame_info.width, frame_info.height, frame_info.component_count,
+                                                         planar.data(), destination, stride, 0);
             }
         }
+        else if (frame_info.bits_per_sample == 2)
+        {
+            vector<std::byte> byte_pixels(static_cast<size_t>(frame_info.width) * frame_info.height);
+            decoder.decode(byte_pixels);
+            if (bilevel)
+            {
+                pack_to_bits(byte_pixels, destination, frame_info.width, frame_info.height, stride);
+            }
+            else
+            {
+                pack_to_crumbs(byte_pixels, destination, frame_info.width, frame_info.height, stride);
+            }
+        }
+        else if (frame_info.bits_per_sample == 4)
+        {
+            vector<std::byte> byte_pixels(static_cast<size_t>(frame_info.width) * frame_info.height);
+            decoder.decode(byte_pixels);
+            pack_to_nibbles(byte_pixels, destination, frame_info.width, frame_info.height, stride);
+        }
+        else
+        {
+            decoder.decode(destination, destination_size, stride);
+
+            // CharLS writes the interleaved samples directly and has no per-line callback: the visible samples of every
+            // row are shifted in place afterwards. Decoding in a transient buffer and shifting while copying would still
+            // take a second pass, with an extra buffer of the size of the image.
+            if (sample_shift != 0)
+            {
+                const size_t sample_count{static_cast<size_t>(frame_info.width) * frame_info.component_count};
+                for (size_t row{}; row != frame_info.height; ++row)
+                {
+                    shift_left(destination + (row * stride), sample_count, sample_shift);
+                }
+            }
+        }
+    }
+    catch (const jpegls_error&)
+    {
+        throw_hresult(wincodec::error_bad_image);
+    }
+}
+
+void decode(jpegls_decoder& decoder, const uint32_t sample_shift,
+            const std::optional<original_components>& source_components, const bool bilevel, std::byte* destination,
+            const size_t destination_size, const uint32_t stride)
+{
+    ASSERT(bilevel || stride >= compute_stride(decoder.frame_info()));
+    const auto& frame_info{decoder.frame_info()};
+
+    if (!source_components && frame_info.component_count != 2)
+    {
+        decode_encoded_components(decoder, sample_shift, bilevel, destination, destination_size, stride);
+        return;
     }
 
-    check_hresult(bitmap.SetResolution(96, 96));
+    // Decode the image with its encoded components in a transient buffer, every row is expanded to the pixel format.
+    const uint32_t encoded_stride{compute_stride(frame_info)};
+    const storage_buffer encoded_pixels{static_cast<size_t>(encoded_stride) * frame_info.height};
+    decode_encoded_components(decoder, 0, false, encoded_pixels.data(), encoded_pixels.size(), encoded_stride);
+
+    for (size_t row{}; row != frame_info.height; ++row)
+    {
+        const std::byte* encoded_row{encoded_pixels.data() + (row * encoded_stride)};
+        std::byte* destination_row{destination + (row * stride)};
+        if (source_components)
+        {
+            restore_components(encoded_row, destination_row, frame_info.width,
+                               static_cast<size_t>(frame_info.component_count), *source_components);
+        }
+        else
+        {
+            expand_gray_alpha(encoded_row, destination_row, frame_info.width);
+        }
+    }
 }
 
+// Copies bit_count bits that start at an arbitrary bit position (used for the 2 and 4 bits per pixel formats).
+void copy_bits(const std::byte* source, const size_t source_size, const size_t bit_offset, std::byte* destination,
+               const size_t bit_count) noexcept
+{
+    const size_t byte_count{(bit_count + 7) / 8};
+    const size_t first{bit_offset / 8};
+    const size_t shift{bit_offset % 8};
+    if (shift == 0)
+    {
+        std::copy_n(source + first, byte_count, destination);
+        return;
+    }
+
+    for (size_t i{}; i != byte_count; ++i)
+    {
+        std::byte value{source[first + i] << shift};
+        if (first + i + 1 < source_size)
+        {
+            value |= source[first + i + 1] >> (8 - shift);
+        }
+        destination[i] = value;
+    }
+}
 
 } // namespace
 
-jpegls_bitmap_frame_decode::jpegls_bitmap_frame_decode(IStream* stream, IWICImagingFactory* factory)
+jpegls_bitmap_frame_decode::jpegls_bitmap_frame_decode(IStream* stream, IWICImagingFactory* factory,
+                                                       const WICDecodeOptions cache_options)
 {
-    ULARGE_INTEGER size;
-    check_hresult(IStream_Size(stream, &size));
+    // Memory-backed and file-backed (mapped) streams are decoded in place, other streams are read into a buffer.
+    std::optional<storage_buffer> buffer;
+    auto memory{stream_memory::from(*check_in_pointer(stream))};
+    if (!memory)
+    {
+        ULARGE_INTEGER size;
+        check_hresult(IStream_Size(stream, &size));
 
-    const storage_buffer buffer{size.LowPart};
-    check_hresult(IStream_Read(stream, buffer.data(), static_cast<ULONG>(buffer.size())));
+        buffer.emplace(size.LowPart);
+        check_hresult(IStream_Read(stream, buffer->data(), static_cast<ULONG>(buffer->size())));
+    }
+    const std::span<const std::byte> encoded_data{memory ? memory->bytes()
+                                                         : std::span<const std::byte>{buffer->data(), buffer->size()}};
 
-    jpegls_decoder decoder{buffer, false};
+    jpegls_decoder decoder{encoded_data, false};
 
     std::error_code error;
     decoder.read_spiff_header(error);
     if (error)
         throw_hresult(wincodec::error_bad_header);
 
+    bool right_aligned{};
+    decoder.at_application_data(
+        [this, &right_aligned](const int32_t application_data_id, const void* data, const size_t size) {
+            const std::span application_data{static_cast<const std::byte*>(data), size};
+            if (application_data_id == original_components::application_data_id && !source_components_)
+            {
+                source_components_ = original_components::from_application_data(application_data);
+            }
+
+            if (application_data_id == right_aligned_samples::application_data_id &&
+                right_aligned_samples::is_application_data(application_data))
+            {
+                right_aligned = true;
+            }
+        });
+
     decoder.read_header(error);
     if (error)
         throw_hresult(wincodec::error_bad_header);
 
-    const auto& frame_info{decoder.frame_info()};
-    auto pixel_format_info{get_pixel_format(frame_info.bits_per_sample, frame_info.component_count)};
+    header_cache::insert(*stream, encoded_data, header_info::from(decoder));
+
+    frame_info_ = decoder.frame_info();
+
+    // A 2 bit image with a maximum sample value of 1 is a bilevel image: decoded with 1 bit per pixel.
+    if (frame_info_.bits_per_sample == 2 && frame_info_.component_count == 1 &&
+        decoder.preset_coding_parameters().maximum_sample_value == 1)
+    {
+        frame_info_.bits_per_sample = 1;
+    }
+
+    if (source_components_)
+    {
+        // Only 8 bit images with 1 (neutral RGB(A)) or 3 (opaque RGBA) components are encoded with fewer components.
+        if (frame_info_.bits_per_sample == 8 && frame_info_.component_count < source_components_->component_count &&
+            (frame_info_.component_count == 1 || frame_info_.component_count == 3))
+        {
+            frame_info_.component_count = source_components_->component_count;
+        }
+        else
+        {
+            source_components_.reset();
+        }
+    }
+    const auto pixel_format_info{get_pixel_format(frame_info_.bits_per_sample, frame_info_.component_count)};
     if (!pixel_format_info)
         throw_hresult(wincodec::error_unsupported_pixel_format);
 
-    const auto& [pixel_format, sample_shift] = pixel_format_info.value();
+    std::tie(pixel_format_, sample_shift_) = pixel_format_info.value();
+
+    // Right-aligned 9 to 15 bit samples are returned as encoded: the unused high bits of the 16 bit pixels are 0.
+    if (right_aligned && frame_info_.bits_per_sample > 8 && frame_info_.bits_per_sample < 16)
+    {
+        sample_shift_ = 0;
+    }
+
+    // Gray + alpha images are decoded as RGBA.
+    if (frame_info_.component_count == 2)
+    {
+        frame_info_.component_count = 4;
+    }
+
+    // The samples of an image with a palette are indices: decoded as is, WIC expands them when RGB is requested.
+    palette_ = read_palette(decoder);
+    if (!palette_.empty() && !source_components_)
+    {
+        pixel_format_ = GUID_WICPixelFormat8bppIndexed;
+    }
+    else
+    {
+        palette_.clear();
+    }
+
+    resolution_ = get_resolution(decoder);
+
+    if (cache_options == WICDecodeMetadataCacheOnDemand)
+    {
+        // Keep only the encoded data: pixels are decoded when requested by CopyPixels.
+        stride_ = compute_stride(frame_info_);
+        if (memory && !memory->shared_global())
+        {
+            stream_memory_.emplace(std::move(*memory));
+            encoded_data_ = encoded_data;
+        }
+        else
+        {
+            if (memory)
+            {
+                // The memory of a HGLOBAL is only locked during construction: keep a copy of the encoded data.
+                buffer.emplace(encoded_data.size());
+                std::ranges::copy(encoded_data, buffer->data());
+            }
+            encoded_buffer_.emplace(std::move(*buffer));
+            encoded_data_ = {encoded_buffer_->data(), encoded_buffer_->size()};
+        }
+        restart_intervals_ = restart_intervals::from(encoded_data_, decoder.frame_info(), decoder.get_interleave_mode());
+        return;
+    }
+
     winrt::com_ptr<IWICBitmap> bitmap;
     check_hresult(
-        factory->CreateBitmap(frame_info.width, frame_info.height, pixel_format, WICBitmapCacheOnLoad, bitmap.put()));
-    set_resolution(decoder, *bitmap);
+        factory->CreateBitmap(frame_info_.width, frame_info_.height, pixel_format_, WICBitmapCacheOnLoad, bitmap.put()));
+    check_hresult(bitmap->SetResolution(resolution_.first, resolution_.second));
 
     {
         winrt::com_ptr<IWICBitmapLock> bitmap_lock;
-        const WICRect complete_image{0, 0, static_cast<int32_t>(frame_info.width), static_cast<int32_t>(frame_info.height)};
+        const WICRect complete_image{0, 0, static_cast<int32_t>(frame_info_.width), static_cast<int32_t>(frame_info_.height)};
         check_hresult(bitmap->Lock(&complete_image, WICBitmapLockWrite, bitmap_lock.put()));
 
         uint32_t stride;
         check_hresult(bitmap_lock->GetStride(&stride));
-        ASSERT(stride >= compute_minimal_stride(frame_info));
 
         std::byte* data_buffer;
         uint32_t data_buffer_size;
         check_hresult(bitmap_lock->GetDataPointer(&data_buffer_size, reinterpret_cast<BYTE**>(&data_buffer)));
         __assume(data_buffer != nullptr);
 
-        try
-        {
-            if (frame_info.component_count != 1 && decoder.get_interleave_mode() == interleave_mode::none)
-            {
-                const auto planar{decoder.decode<vector<std::byte>>()};
-                if (frame_info.bits_per_sample > 8)
-                {
-                    convert_planar_to_rgb<uint16_t>(frame_info.width, frame_info.height, planar.data(), data_buffer, stride);
-                }
-                else
-                {
-                    convert_planar_to_rgb<std::byte>(frame_info.width, frame_info.height, planar.data(), data_buffer,
-                                                     stride);
-                }
-            }
-            else if (frame_info.bits_per_sample == 2)
-            {
-                vector<std::byte> byte_pixels(static_cast<size_t>(frame_info.width) * frame_info.height);
-                decoder.decode(byte_pixels);
-                pack_to_crumbs(byte_pixels, data_buffer, frame_info.width, frame_info.height, stride);
-            }
-            else if (frame_info.bits_per_sample == 4)
-            {
-                vector<std::byte> byte_pixels(static_cast<size_t>(frame_info.width) * frame_info.height);
-                decoder.decode(byte_pixels);
-                pack_to_nibbles(byte_pixels, data_buffer, frame_info.width, frame_info.height, stride);
-            }
-            else
-            {
-                decoder.decode(data_buffer, data_buffer_size, stride);
-
-                if (sample_shift != 0)
-                {
-                    shift_samples(data_buffer, data_buffer_size / 2, sample_shift);
-                }
-            }
-        }
-        catch (const jpegls_error&)
-        {
-            throw_hresult(wincodec::error_bad_image);
-        }
+        decode(decoder, sample_shift_, source_components_, bilevel(), data_buffer, data_buffer_size, stride);
     }
 
     check_hresult(bitmap->QueryInterface(bitmap_source_.put()));
 }
 
 // IWICBitmapSource
-HRESULT jpegls_bitmap_frame_decode::GetSize(uint32_t* width, uint32_t* height)
+HRESULT jpegls_bitmap_frame_decode::GetSize(uint32_t* width, uint32_t* height) noexcept
+try
 {
     TRACE("{} jpegls_bitmap_frame_decoder::GetSize, width={}, height={}\n", fmt::ptr(this), fmt::ptr(width),
           fmt::ptr(height));
 
-    return bitmap_source_->GetSize(width, height);
+    *check_in_pointer(width) = frame_info_.width;
+    *check_in_pointer(height) = frame_info_.height;
+    return success_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
-HRESULT jpegls_bitmap_frame_decode::GetPixelFormat(GUID* pixel_format)
+HRESULT jpegls_bitmap_frame_decode::GetPixelFormat(GUID* pixel_format) noexcept
+try
 {
     TRACE("{} jpegls_bitmap_frame_decoder::GetPixelFormat, pixel_format={}\n", fmt::ptr(this), fmt::ptr(pixel_format));
 
-    return bitmap_source_->GetPixelFormat(pixel_format);
+    *check_in_pointer(pixel_format) = pixel_format_;
+    return success_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
-HRESULT jpegls_bitmap_frame_decode::GetResolution(double* dpi_x, double* dpi_y)
+HRESULT jpegls_bitmap_frame_decode::GetResolution(double* dpi_x, double* dpi_y) noexcept
+try
 {
     TRACE("{} jpegls_bitmap_frame_decoder::GetResolution, dpi_x={}, dpi_y={}\n", fmt::ptr(this), fmt::ptr(dpi_x),
           fmt::ptr(dpi_y));
 
-    return bitmap_source_->GetResolution(dpi_x, dpi_y);
+    *check_in_pointer(dpi_x) = resolution_.first;
+    *check_in_pointer(dpi_y) = resolution_.second;
+    return success_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
 HRESULT jpegls_bitmap_frame_decode::CopyPixels(const WICRect* rectangle, const uint32_t stride, const uint32_t buffer_size,
-                                               BYTE* buffer)
+                                               BYTE* buffer) noexcept
+try
 {
     TRACE("{} jpegls_bitmap_frame_decoder::CopyPixels, rectangle={}, stride={}, buffer_size={}, buffer={}\n", fmt::ptr(this),
           fmt::ptr(rectangle), stride, buffer_size, fmt::ptr(buffer));
 
-    return bitmap_source_->CopyPixels(rectangle, stride, buffer_size, buffer);
+    if (bitmap_source_)
+        return bitmap_source_->CopyPixels(rectangle, stride, buffer_size, buffer);
+
+    const WICRect complete_image{0, 0, static_cast<int32_t>(frame_info_.width), static_cast<int32_t>(frame_info_.height)};
+    const WICRect& source_rectangle{rectangle ? *rectangle : complete_image};
+    check_condition(source_rectangle.X >= 0 && source_rectangle.Y >= 0 && source_rectangle.Width >= 0 &&
+                        source_rectangle.Height >= 0 &&
+                        static_cast<uint32_t>(source_rectangle.X) + source_rectangle.Width <= frame_info_.width &&
+                        static_cast<uint32_t>(source_rectangle.Y) + source_rectangle.Height <= frame_info_.height,
+                    error_invalid_argument);
+    if (source_rectangle.Width == 0 || source_rectangle.Height == 0)
+        return success_ok;
+
+    const uint64_t row_size{((static_cast<uint64_t>(source_rectangle.Width) * compute_bits_per_pixel(frame_info_)) + 7) / 8};
+    check_condition(stride >= row_size, error_invalid_argument);
+    check_condition(buffer_size >= (static_cast<uint64_t>(stride) * (source_rectangle.Height - 1)) + row_size,
+                    wincodec::error_insufficient_buffer);
+
+    copy_pixels_on_demand(source_rectangle, stride, reinterpret_cast<std::byte*>(check_in_pointer(buffer)));
+    return success_ok;
+}
+catch (...)
+{
+    return to_hresult();
 }
 
-HRESULT jpegls_bitmap_frame_decode::CopyPalette(IWICPalette* /*palette*/) noexcept
+HRESULT jpegls_bitmap_frame_decode::CopyPalette(IWICPalette* palette) noexcept
+try
+{
+    TRACE("{} jpegls_bitmap_frame_decoder::CopyPalette, palette={}\n", fmt::ptr(this), fmt::ptr(palette));
+
+    check_in_pointer(palette);
+    if (palette_.empty())
+        return wincodec::error_palette_unavailable;
+
+    check_hresult(palette->InitializeCustom(palette_.data(), static_cast<uint32_t>(palette_.size())));
+    return success_ok;
+}
+catch (...)
 {
-    TRACE("{} jpegls_bitmap_frame_decoder::CopyPalette\n", fmt::ptr(this));
-    return wincodec::error_palette_unavailable;
+    return to_hresult();
 }
 
 // IWICBitmapFrameDecode : IWICBitmapSource
@@ -400,3 +707,74 @@ bool jpegls_bitmap_frame_decode::can_decode_to_wic_pixel_format(const int32_t bi
 {
     return get_pixel_format(bits_per_sample, component_count).has_value();
 }
+
+void jpegls_bitmap_frame_decode::copy_pixels_on_demand(const WICRect& rectangle, const uint32_t stride, std::byte* buffer)
+{
+    const uint32_t first_row{static_cast<uint32_t>(rectangle.Y)};
+    const uint32_t row_count{static_cast<uint32_t>(rectangle.Height)};
+
+    std::scoped_lock lock{mutex_};
+
+    if (!band_ || first_row < band_first_row_ || first_row + row_count > band_first_row_ + band_row_count_)
+    {
+        fill_band_cache(first_row, row_count);
+    }
+
+    const size_t bits_per_pixel{compute_bits_per_pixel(frame_info_)};
+    const size_t bit_offset{static_cast<size_t>(rectangle.X) * bits_per_pixel};
+    const size_t bit_count{static_cast<size_t>(rectangle.Width) * bits_per_pixel};
+    const std::byte* band_row{band_->data() + (static_cast<size_t>(first_row - band_first_row_) * stride_)};
+    for (uint32_t row{}; row != row_count; ++row)
+    {
+        copy_bits(band_row, stride_, bit_offset, buffer, bit_count);
+        band_row += stride_;
+        buffer += stride;
+    }
+}
+
+// Images with restart intervals: decodes the intervals that contain the requested rows, the band is extended (up to a
+// memory budget) to serve the next requests of callers that copy the image in strips from top to bottom.
+// JPEG-LS has no random access to the rows of other images: they are decoded completely at the first request, the
+// encoded data is then released (the memory use is the same as WICDecodeMetadataCacheOnLoad).
+void jpegls_bitmap_frame_decode::fill_band_cache(const uint32_t first_row, const uint32_t row_count)
+{
+    band_.reset();
+
+    if (!restart_intervals_)
+    {
+        jpegls_decoder decoder{encoded_data_, false};
+        decoder.read_spiff_header();
+        decoder.read_header();
+
+        storage_buffer image{static_cast<size_t>(stride_) * frame_info_.height};
+        decode(decoder, sample_shift_, source_components_, bilevel(), image.data(), image.size(), stride_);
+        band_.emplace(std::move(image));
+        band_first_row_ = 0;
+        band_row_count_ = frame_info_.height;
+
+        encoded_data_ = {};
+        encoded_buffer_.reset();
+        stream_memory_.reset();
+        return;
+    }
+
+    constexpr size_t band_cache_size{static_cast<size_t>(4) * 1024 * 1024};
+    const uint32_t interval_height{restart_intervals_->interval_height()};
+    const uint32_t first_interval{first_row / interval_height};
+    const uint32_t last_interval{(first_row + row_count - 1) / interval_height};
+    const auto budget_interval_count{
+        static_cast<uint32_t>(std::min(band_cache_size / stride_ / interval_height, size_t{restart_intervals_->count()}))};
+    const uint32_t interval_count{std::min(std::max(last_interval - first_interval + 1, budget_interval_count),
+                                           restart_intervals_->count() - first_interval)};
+
+    const storage_buffer intervals{restart_intervals_->extract(first_interval, interval_count)};
+    jpegls_decoder decoder{std::span<const std::byte>{intervals.data(), intervals.size()}, false};
+    decoder.read_spiff_header();
+    decoder.read_header();
+
+    storage_buffer band{static_cast<size_t>(stride_) * decoder.frame_info().height};
+    decode(decoder, sample_shift_, source_components_, bilevel(), band.data(), band.size(), stride_);
+    band_.emplace(std::move(band));
+    band_first_row_ = first_interval * interval_height;
+    band_row_count_ = decoder.frame_info().height;
+}
@@ -6,6 +6,12 @@ export module jpegls_bitmap_frame_decode;
 import std;
 import <win.hpp>;
 import winrt_base;
+import charls;
+
+import original_components;
+import restart_intervals;
+import storage_buffer;
+import stream_memory;
 
 using std::int32_t;
 using std::uint32_t;
@@ -13,14 +19,15 @@ using std::uint32_t;
 export struct jpegls_bitmap_frame_decode
     : winrt::implements<jpegls_bitmap_frame_decode, IWICBitmapFrameDecode, IWICBitmapSource>
 {
-    jpegls_bitmap_frame_decode(IStream* stream, IWICImagingFactory* factory);
+    jpegls_bitmap_frame_decode(IStream* stream, IWICImagingFactory* factory, WICDecodeOptions cache_options);
 
     // IWICBitmapSource
-    HRESULT __stdcall GetSize(uint32_t* width, uint32_t* height) override;
-    HRESULT __stdcall GetPixelFormat(GUID* pixel_format) override;
-    HRESULT __stdcall GetResolution(double* dpi_x, double* dpi_y) override;
-    HRESULT __stdcall CopyPixels(const WICRect* rectangle, uint32_t stride, uint32_t buffer_size, BYTE* buffer) override;
-    HRESULT __stdcall CopyPalette(IWICPalette* /*palette*/) noexcept override;
+    HRESULT __stdcall GetSize(uint32_t* width, uint32_t* height) noexcept override;
+    HRESULT __stdcall GetPixelFormat(GUID* pixel_format) noexcept override;
+    HRESULT __stdcall GetResolution(double* dpi_x, double* dpi_y) noexcept override;
+    HRESULT __stdcall CopyPixels(const WICRect* rectangle, uint32_t stride, uint32_t buffer_size,
+                                 BYTE* buffer) noexcept override;
+    HRESULT __stdcall CopyPalette(IWICPalette* palette) noexcept override;
 
     // IWICBitmapFrameDecode : IWICBitmapSource
     HRESULT __stdcall GetThumbnail(IWICBitmapSource** /*source*/) noexcept override;
@@ -32,5 +39,36 @@ export struct jpegls_bitmap_frame_decode
     static bool can_decode_to_wic_pixel_format(int32_t bits_per_sample, int32_t component_count) noexcept;
 
 private:
+    [[nodiscard]]
+    bool bilevel() const noexcept
+    {
+        return frame_info_.bits_per_sample == 1;
+    }
+
+    void copy_pixels_on_demand(const WICRect& rectangle, uint32_t stride, std::byte* buffer);
+    void fill_band_cache(uint32_t first_row, uint32_t row_count);
+
+    charls::frame_info frame_info_{};
+    GUID pixel_format_{};
+    uint32_t sample_shift_{};
+    std::optional<original_components> source_components_; // Set when the image is encoded with fewer components.
+    std::vector<WICColor> palette_; // Set for 8 bit images with a mapping table (pixel format 8bppIndexed).
+    std::pair<double, double> resolution_{};
+
+    // WICDecodeMetadataCacheOnLoad: the complete image is decoded during construction.
     winrt::com_ptr<IWICBitmapSource> bitmap_source_;
+
+    // WICDecodeMetadataCacheOnDemand: only the encoded data is resident until pixels are requested. Images with restart
+    // intervals keep the recently decoded intervals in a bounded band cache. Other images are decoded completely at the
+    // first request, after which only the decoded image is kept.
+    // The encoded data is owned by stream_memory_ (memory-backed or mapped file-backed streams) or by encoded_buffer_.
+    std::mutex mutex_;
+    std::optional<stream_memory> stream_memory_;
+    std::optional<storage_buffer> encoded_buffer_;
+    std::span<const std::byte> encoded_data_;
+    std::optional<restart_intervals> restart_intervals_;
+    uint32_t stride_{};
+    uint32_t band_first_row_{};
+    uint32_t band_row_count_{};
+    std::optional<storage_buffer> band_;
 };
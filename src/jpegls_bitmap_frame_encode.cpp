@@ -12,17 +12,174 @@ import winrt_base;
 import <win.hpp>;
 
 import hresults;
+import parameter_selection;
+import pixel_conversion;
+import storage_buffer;
 import util;
 import "macros.hpp";
 
+using std::int32_t;
 using std::uint32_t;
 
-HRESULT __stdcall jpegls_bitmap_frame_encode::Initialize([[maybe_unused]] IPropertyBag2* encoder_options) noexcept
+namespace {
+
+void unpack_bits(const std::byte* bits_row, std::byte* destination, const size_t width) noexcept
+{
+    const size_t i{width / 8};
+    expand_bits(bits_row, destination, i);
+
+    for (size_t bit{}; bit != width % 8; ++bit)
+    {
+        destination[(i * 8) + bit] = (bits_row[i] >> (7 - bit)) & std::byte{0x01};
+    }
+}
+
+// Note: the samples of a partial last byte are unpacked in the same order as previous versions.
+void unpack_crumbs(const std::byte* crumbs_row, std::byte* destination, const size_t width) noexcept
+{
+    const size_t i{width / 4};
+    expand_crumbs(crumbs_row, destination, i);
+    destination += i * 4;
+
+    switch (width % 4)
+    {
+    case 3:
+        *destination++ = crumbs_row[i] >> 6;
+        [[fallthrough]];
+    case 2:
+        *destination++ = (crumbs_row[i] & std::byte{0x30}) >> 4;
+        [[fallthrough]];
+    case 1:
+        *destination = (crumbs_row[i] & std::byte{0x0C}) >> 2;
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Keeps the first kept_count components of every pixel. The destination may start at (or before) the source.
+void remove_components(const std::byte* source, std::byte* destination, const size_t pixel_count,
+                       const size_t component_count, const size_t kept_count) noexcept
+{
+    for (size_t i{}; i != pixel_count; ++i)
+    {
+        for (size_t component{}; component != kept_count; ++component)
+        {
+            destination[(i * kept_count) + component] = source[(i * component_count) + component];
+        }
+    }
+}
+
+void unpack_nibbles(const std::byte* nibble_row, std::byte* destination, const size_t width) noexcept
+{
+    const size_t i{width / 2};
+    expand_nibbles(nibble_row, destination, i);
+
+    if (width % 2)
+    {
+        destination[i * 2] = nibble_row[i] >> 4;
+    }
+}
+
+// Converts the colors of a palette (0xAARRGGBB) to the entries of a mapping table: RGB, or RGBA when it has alpha.
+[[nodiscard]]
+mapping_table to_mapping_table(IWICPalette& palette)
+{
+    uint32_t color_count;
+    winrt::check_hresult(palette.GetColorCount(&color_count));
+    check_condition(color_count != 0, wincodec::error_palette_unavailable);
+    check_condition(color_count <= 256, error_invalid_argument); // Indices are stored as 8 bit samples.
+
+    std::array<WICColor, 256> colors;
+    winrt::check_hresult(palette.GetColors(color_count, colors.data(), &color_count));
+
+    BOOL has_alpha;
+    winrt::check_hresult(palette.HasAlpha(&has_alpha));
+
+    mapping_table table{.entry_size = has_alpha ? 4 : 3, .entries = {}};
+    table.entries.reserve(static_cast<size_t>(color_count) * table.entry_size);
+    for (const WICColor color : std::span{colors.data(), color_count})
+    {
+        table.entries.push_back(static_cast<std::byte>(color >> 16));
+        table.entries.push_back(static_cast<std::byte>(color >> 8));
+        table.entries.push_back(static_cast<std::byte>(color));
+        if (has_alpha)
+        {
+            table.entries.push_back(static_cast<std::byte>(color >> 24));
+        }
+    }
+
+    return table;
+}
+
+// Returns no value when the source has no palette.
+[[nodiscard]]
+std::optional<mapping_table> copy_palette(IWICBitmapSource& bitmap_source)
+{
+    winrt::com_ptr<IWICImagingFactory> factory;
+    winrt::check_hresult(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+                                          IID_PPV_ARGS(factory.put())));
+
+    winrt::com_ptr<IWICPalette> palette;
+    winrt::check_hresult(factory->CreatePalette(palette.put()));
+    if (FAILED(bitmap_source.CopyPalette(palette.get())))
+        return {};
+
+    return to_mapping_table(*palette);
+}
+
+} // namespace
+
+jpegls_bitmap_frame_encode::jpegls_bitmap_frame_encode(IStream* destination, const WICBitmapEncoderCacheOption cache_option)
+{
+    if (cache_option == WICBitmapEncoderNoCache)
+    {
+        destination_.copy_from(destination);
+    }
+}
+
+// Copies line_count lines to the pixel buffer with copy(first_line, line_count, destination). In streaming mode the
+// lines are split over the stripes, every complete stripe is passed to a worker thread.
+template<typename CopyLines>
+void jpegls_bitmap_frame_encode::receive_lines(const uint32_t line_count, CopyLines copy)
+{
+    if (!stripe_encoder_)
+    {
+        copy(0, line_count, source_->data() + (static_cast<size_t>(received_line_count_) * source_stride_));
+        received_line_count_ += line_count;
+        return;
+    }
+
+    for (uint32_t copied_line_count{}; copied_line_count != line_count;)
+    {
+        const uint32_t stripe_line_count{stripe_encoder_->line_count(stripe_index_)};
+        const uint32_t buffered_line_count{received_line_count_ - (stripe_index_ * stripe_encoder_->stripe_height())};
+        const uint32_t copy_line_count{std::min(line_count - copied_line_count, stripe_line_count - buffered_line_count)};
+
+        copy(copied_line_count, copy_line_count,
+             source_->data() + (static_cast<size_t>(buffered_line_count) * source_stride_));
+
+        copied_line_count += copy_line_count;
+        received_line_count_ += copy_line_count;
+        if (buffered_line_count + copy_line_count == stripe_line_count)
+        {
+            write_stripe();
+        }
+    }
+}
+
+HRESULT __stdcall jpegls_bitmap_frame_encode::Initialize(IPropertyBag2* encoder_options) noexcept
 try
 {
     TRACE("{} jpegls_bitmap_frame_encode::Initialize, encoder_options={}\n", fmt::ptr(this), fmt::ptr(encoder_options));
 
     check_condition(state_ == state::created, wincodec::error_wrong_state);
+    if (encoder_options)
+    {
+        options_ = encoder_options::read(*encoder_options);
+    }
+
     state_ = state::initialized;
     return success_ok;
 }
@@ -54,6 +211,7 @@ try
     TRACE("{} jpegls_bitmap_frame_encode::SetResolution.1, dpi_x={}, dpi_y={}\n", fmt::ptr(this), dpi_x, dpi_y);
 
     check_condition(state_ != state::commited, wincodec::error_wrong_state);
+    check_condition(!stripe_encoder_, wincodec::error_wrong_state); // The stripe encoder has copied it.
 
     const auto resolution_x{std::lround(dpi_x)};
     const auto resolution_y{std::lround(dpi_y)};
@@ -77,58 +235,83 @@ try
 
     swap_pixels_ = false;
 
+    if (*pixel_format == GUID_WICPixelFormatBlackWhite)
+    {
+        set_pixel_format(*pixel_format, 2, 1);
+        return success_ok;
+    }
+
     if (*pixel_format == GUID_WICPixelFormat2bppGray)
     {
-        set_pixel_format(2, 1);
+        set_pixel_format(*pixel_format, 2, 1);
         return success_ok;
     }
 
     if (*pixel_format == GUID_WICPixelFormat4bppGray)
     {
-        set_pixel_format(4, 1);
+        set_pixel_format(*pixel_format, 4, 1);
         return success_ok;
     }
 
     if (*pixel_format == GUID_WICPixelFormat8bppGray)
     {
-        set_pixel_format(8, 1);
+        set_pixel_format(*pixel_format, 8, 1);
+        return success_ok;
+    }
+
+    if (*pixel_format == GUID_WICPixelFormat8bppIndexed)
+    {
+        set_pixel_format(*pixel_format, 8, 1);
         return success_ok;
     }
 
     if (*pixel_format == GUID_WICPixelFormat16bppGray)
     {
-        set_pixel_format(16, 1);
+        set_pixel_format(*pixel_format, 16, 1);
         return success_ok;
     }
 
     if (*pixel_format == GUID_WICPixelFormat24bppRGB)
     {
-        set_pixel_format(8, 3);
+        set_pixel_format(*pixel_format, 8, 3);
         return success_ok;
     }
 
     if (*pixel_format == GUID_WICPixelFormat24bppBGR)
     {
-        set_pixel_format(8, 3);
+        set_pixel_format(*pixel_format, 8, 3);
         swap_pixels_ = true;
         return success_ok;
     }
 
     if (*pixel_format == GUID_WICPixelFormat48bppRGB)
     {
-        set_pixel_format(16, 3);
+        set_pixel_format(*pixel_format, 16, 3);
         return success_ok;
     }
 
     if (*pixel_format == GUID_WICPixelFormat32bppRGBA)
     {
-        set_pixel_format(8, 4);
+        set_pixel_format(*pixel_format, 8, 4);
         return success_ok;
     }
 
     if (*pixel_format == GUID_WICPixelFormat32bppBGRA)
     {
-        set_pixel_format(8, 4);
+        set_pixel_format(*pixel_format, 8, 4);
+        swap_pixels_ = true;
+        return success_ok;
+    }
+
+    if (*pixel_format == GUID_WICPixelFormat64bppRGBA)
+    {
+        set_pixel_format(*pixel_format, 16, 4);
+        return success_ok;
+    }
+
+    if (*pixel_format == GUID_WICPixelFormat64bppBGRA)
+    {
+        set_pixel_format(*pixel_format, 16, 4);
         swap_pixels_ = true;
         return success_ok;
     }
@@ -170,13 +353,13 @@ try
     check_condition(received_line_count_ + line_count <= frame_info_.height, wincodec::error_codec_too_many_scan_lines);
 
     allocate_pixel_buffer();
-    const size_t destination_stride{source_stride_};
+    const auto* source{reinterpret_cast<const std::byte*>(check_in_pointer(pixels))};
+    receive_lines(line_count, [this, source, source_stride](const uint32_t first_line, const uint32_t copy_line_count,
+                                                            std::byte* destination) {
+        copy_lines(source + (static_cast<size_t>(first_line) * source_stride), source_stride, destination,
+                   copy_line_count);
+    });
 
-    std::byte* destination{source_.data() + (received_line_count_ * destination_stride)};
-    winrt::check_hresult(MFCopyImage(reinterpret_cast<BYTE*>(destination), static_cast<LONG>(destination_stride), pixels,
-                                     static_cast<LONG>(source_stride), static_cast<DWORD>(destination_stride), line_count));
-
-    received_line_count_ += line_count;
     state_ = received_pixels;
     return success_ok;
 }
@@ -186,21 +369,34 @@ catch (...)
 }
 
 HRESULT __stdcall jpegls_bitmap_frame_encode::WriteSource(_In_ IWICBitmapSource* bitmap_source,
-                                                          [[maybe_unused]] _In_ WICRect* rectangle) noexcept
+                                                          _In_ WICRect* rectangle) noexcept
 try
 {
     TRACE("{} jpegls_bitmap_frame_encode::WriteSource, bitmap_source={}, rectangle={}\n", fmt::ptr(this),
           fmt::ptr(bitmap_source), fmt::ptr(rectangle));
 
-    check_condition(state_ == state::initialized, wincodec::error_wrong_state);
+    using enum state;
+    check_condition(state_ == initialized || state_ == received_pixels, wincodec::error_wrong_state);
     check_in_pointer(bitmap_source);
 
+    uint32_t source_width;
+    uint32_t source_height;
+    winrt::check_hresult(bitmap_source->GetSize(&source_width, &source_height));
+
+    // The rectangle selects the lines (with the width of the frame) that are appended to the received lines.
+    WICRect area{0, 0, static_cast<int32_t>(source_width), static_cast<int32_t>(source_height)};
+    if (rectangle)
+    {
+        check_condition(rectangle->X >= 0 && rectangle->Y >= 0 && rectangle->Width > 0 && rectangle->Height > 0 &&
+                            static_cast<uint32_t>(rectangle->X) + rectangle->Width <= source_width &&
+                            static_cast<uint32_t>(rectangle->Y) + rectangle->Height <= source_height,
+                        error_invalid_argument);
+        area = *rectangle;
+    }
+
     if (!size_set_)
     {
-        uint32_t width;
-        uint32_t height;
-        winrt::check_hresult(bitmap_source->GetSize(&width, &height));
-        winrt::check_hresult(SetSize(width, height));
+        winrt::check_hresult(SetSize(area.Width, area.Height));
     }
 
     if (!pixel_format_set_)
@@ -210,11 +406,29 @@ try
         winrt::check_hresult(SetPixelFormat(&pixel_format));
     }
 
+    // The palette of an indexed source is used when no palette is set.
+    if (indexed() && !palette_)
+    {
+        palette_ = copy_palette(*bitmap_source);
+    }
+
+    const auto line_count{static_cast<uint32_t>(area.Height)};
+    check_condition(static_cast<uint32_t>(area.Width) == frame_info_.width, error_invalid_argument);
+    check_condition(received_line_count_ + line_count <= frame_info_.height, wincodec::error_codec_too_many_scan_lines);
+
+    if (use_locked_source(*bitmap_source, area))
+    {
+        state_ = received_pixels;
+        return success_ok;
+    }
+
     allocate_pixel_buffer();
+    receive_lines(line_count, [this, bitmap_source, &area](const uint32_t first_line, const uint32_t copy_line_count,
+                                                           std::byte* destination) {
+        copy_source_lines(*bitmap_source, area, first_line, copy_line_count, destination);
+    });
 
-    winrt::check_hresult(bitmap_source->CopyPixels(nullptr, source_stride_, static_cast<uint32_t>(source_.size()),
-                                                   reinterpret_cast<BYTE*>(source_.data())));
-    state_ = state::received_pixels;
+    state_ = received_pixels;
     return success_ok;
 }
 catch (...)
@@ -229,17 +443,18 @@ try
     check_condition(state_ == state::received_pixels, wincodec::error_wrong_state);
     ASSERT(size_set_ && pixel_format_set_);
 
-    if (swap_pixels_)
-    {
-        convert_bgr_to_rgb(frame_info_.component_count);
-    }
-    else if (frame_info_.bits_per_sample == 2)
+    // The pixel buffer is not initialized: all lines must be received.
+    check_condition(received_line_count_ == frame_info_.height, wincodec::error_wrong_state);
+    if (stripe_encoder_)
     {
-        unpack_crumbs();
+        write_encoded_stripes(0);
+
+        write_to_stream(*destination_, stripe_encoder::end_of_image());
+        destination_ = nullptr;
     }
-    else if (frame_info_.bits_per_sample == 4)
+    else
     {
-        unpack_nibbles();
+        prepare_frame();
     }
 
     state_ = state::commited;
@@ -250,8 +465,391 @@ catch (...)
     return to_hresult();
 }
 
-HRESULT __stdcall jpegls_bitmap_frame_encode::SetPalette([[maybe_unused]] _In_ IWICPalette* palette) noexcept
+// Note: the palette is only used for indexed pixel formats and can't be changed after the headers are encoded.
+HRESULT __stdcall jpegls_bitmap_frame_encode::SetPalette(_In_ IWICPalette* palette) noexcept
+try
 {
     TRACE("{} jpegls_bitmap_frame_encode::SetPalette, palette={}\n", fmt::ptr(this), fmt::ptr(palette));
-    return wincodec::error_palette_unavailable;
+
+    using enum state;
+    check_in_pointer(palette);
+    check_condition((state_ == initialized || state_ == received_pixels) && !stripe_encoder_ && !frame_prepared_,
+                    wincodec::error_wrong_state);
+
+    palette_ = to_mapping_table(*palette);
+    return success_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+HRESULT __stdcall jpegls_bitmap_frame_encode::EstimateSize(ULONGLONG* estimated_size, ULONGLONG* error_bound) noexcept
+try
+{
+    TRACE("{} jpegls_bitmap_frame_encode::EstimateSize, estimated_size={}, error_bound={}\n", fmt::ptr(this),
+          fmt::ptr(estimated_size), fmt::ptr(error_bound));
+
+    check_out_pointer(estimated_size);
+    check_out_pointer(error_bound);
+    check_condition(state_ == state::received_pixels && received_line_count_ == frame_info_.height && !stripe_encoder_,
+                    wincodec::error_wrong_state);
+
+    prepare_frame();
+    const auto [size, bound]{estimate_size(parameters(), pixels(), source_stride_)};
+    *estimated_size = size;
+    *error_bound = bound;
+    return success_ok;
+}
+catch (...)
+{
+    return to_hresult();
+}
+
+// Copies lines to the pixel buffer and converts them to the layout of the JPEG-LS encoder during the copy: every pixel
+// is read and written once. The source and destination may be the same lines (in place conversion). Redundant
+// components are detected in every line directly after it is copied, while it is still in the processor cache.
+// Note: only the visible width is converted, the padding bytes of the rows are not touched.
+void jpegls_bitmap_frame_encode::copy_lines(const std::byte* source, const uint32_t source_stride, std::byte* destination,
+                                            const uint32_t line_count) noexcept
+{
+    const size_t width{frame_info_.width};
+    const int32_t component_count{frame_info_.component_count};
+    const size_t row_size{width * component_count * (frame_info_.bits_per_sample <= 8 ? 1 : 2)};
+    const bool detect_redundant{detect_redundant_components()};
+    for (uint32_t line{}; line != line_count; ++line)
+    {
+        const std::byte* source_row{source + (static_cast<size_t>(line) * source_stride)};
+        std::byte* destination_row{destination + (static_cast<size_t>(line) * source_stride_)};
+
+        if (detect_redundant && !redundant_)
+        {
+            redundant_.emplace(redundant_components{.neutral = true,
+                                                    .constant_alpha = component_count == 4,
+                                                    .alpha = component_count == 4 ? source_row[3] : std::byte{}});
+        }
+
+        if (swap_pixels_)
+        {
+            if (frame_info_.bits_per_sample <= 8)
+            {
+                copy_swap_red_blue(source_row, destination_row, width, component_count);
+            }
+            else
+            {
+                copy_swap_red_blue_16(source_row, destination_row, width);
+            }
+            source_row = destination_row; // The remaining conversion is done in place.
+        }
+
+        switch (frame_info_.bits_per_sample)
+        {
+        case 2:
+            if (bilevel())
+            {
+                unpack_bits(source_row, destination_row, width);
+            }
+            else
+            {
+                unpack_crumbs(source_row, destination_row, width);
+            }
+            break;
+
+        case 4:
+            unpack_nibbles(source_row, destination_row, width);
+            break;
+
+        default:
+            if (convert_samples())
+            {
+                sample_bits_ |= copy_shift_right(source_row, destination_row, row_size / 2, sample_shift_);
+            }
+            else if (source_row != destination_row)
+            {
+                std::memcpy(destination_row, source_row, row_size);
+            }
+            break;
+        }
+
+        if (detect_redundant && redundant_->any())
+        {
+            find_redundant_components(destination_row, width, component_count, *redundant_);
+        }
+    }
+}
+
+// Copies lines of an area of a bitmap source to the pixel buffer. The lines are retrieved in small bands: a source that
+// decodes on demand only needs to provide a few lines at a time, and the pixels are converted while the band is still
+// in the processor cache. Packed 2 and 4 bit pixels are retrieved into a staging buffer and unpacked.
+void jpegls_bitmap_frame_encode::copy_source_lines(IWICBitmapSource& bitmap_source, const WICRect& area,
+                                                   const uint32_t first_line, const uint32_t line_count,
+                                                   std::byte* destination)
+{
+    // The pixels of a bitmap are converted directly from its memory.
+    const WICRect locked_rectangle{area.X, area.Y + static_cast<int32_t>(first_line), area.Width,
+                                   static_cast<int32_t>(line_count)};
+    if (const auto locked{lock_pixels(bitmap_source, locked_rectangle)}; locked)
+    {
+        copy_lines(locked->pixels.data(), locked->stride, destination, line_count);
+        return;
+    }
+
+    constexpr uint32_t maximum_band_line_count{64};
+
+    std::optional<storage_buffer> band;
+    const uint32_t packed_stride{compute_stride()};
+    if (packed_pixels())
+    {
+        band.emplace(
+            buffer_pool_.acquire(static_cast<size_t>(packed_stride) * std::min(maximum_band_line_count, line_count)));
+    }
+
+    for (uint32_t line{}; line < line_count; line += maximum_band_line_count)
+    {
+        const uint32_t band_line_count{std::min(maximum_band_line_count, line_count - line)};
+        const WICRect rectangle{area.X, area.Y + static_cast<int32_t>(first_line + line), area.Width,
+                                static_cast<int32_t>(band_line_count)};
+        std::byte* band_destination{destination + (static_cast<size_t>(line) * source_stride_)};
+
+        if (band)
+        {
+            winrt::check_hresult(bitmap_source.CopyPixels(&rectangle, packed_stride, packed_stride * band_line_count,
+                                                          reinterpret_cast<BYTE*>(band->data())));
+            copy_lines(band->data(), packed_stride, band_destination, band_line_count);
+            continue;
+        }
+
+        winrt::check_hresult(bitmap_source.CopyPixels(&rectangle, source_stride_, source_stride_ * band_line_count,
+                                                      reinterpret_cast<BYTE*>(band_destination)));
+        if (copy_converts_pixels())
+        {
+            copy_lines(band_destination, source_stride_, band_destination, band_line_count); // In place.
+        }
+    }
+
+    if (band)
+    {
+        buffer_pool_.release(std::move(*band));
+    }
+}
+
+// Returns no value when the source is not a bitmap with the pixel format of the frame or when it can't be locked.
+std::optional<jpegls_bitmap_frame_encode::locked_pixels>
+jpegls_bitmap_frame_encode::lock_pixels(IWICBitmapSource& bitmap_source, const WICRect& rectangle) const
+{
+    // Packed pixels can only be locked from the start of a row.
+    winrt::com_ptr<IWICBitmap> bitmap;
+    if ((packed_pixels() && rectangle.X != 0) || FAILED(bitmap_source.QueryInterface(bitmap.put())))
+        return {};
+
+    GUID pixel_format;
+    winrt::com_ptr<IWICBitmapLock> lock;
+    if (FAILED(bitmap->GetPixelFormat(&pixel_format)) || pixel_format != pixel_format_ ||
+        FAILED(bitmap->Lock(&rectangle, WICBitmapLockRead, lock.put())))
+        return {};
+
+    uint32_t size;
+    BYTE* data;
+    uint32_t stride;
+    const size_t row_size{
+        ((static_cast<size_t>(frame_info_.width) * frame_info_.component_count * bits_per_pixel_sample()) + 7) / 8};
+    if (FAILED(lock->GetDataPointer(&size, &data)) || FAILED(lock->GetStride(&stride)) || stride < row_size)
+        return {};
+
+    // Note: the last row is not always padded to the stride.
+    if (size < (static_cast<size_t>(stride) * (rectangle.Height - 1)) + row_size)
+        return {};
+
+    return locked_pixels{
+        .lock = std::move(lock), .pixels = {reinterpret_cast<const std::byte*>(data), size}, .stride = stride};
+}
+
+// Encodes the frame directly from the memory of a bitmap when it is written with 1 call and needs no conversion:
+// prevents a copy of the complete image. The lock is kept until the encoder has written the frame.
+bool jpegls_bitmap_frame_encode::use_locked_source(IWICBitmapSource& bitmap_source, const WICRect& area)
+{
+    if (destination_ || copy_converts_pixels() || source_ || received_line_count_ != 0 ||
+        static_cast<uint32_t>(area.Height) != frame_info_.height)
+        return false;
+
+    auto locked{lock_pixels(bitmap_source, area)};
+    if (!locked || locked->pixels.size() < static_cast<size_t>(locked->stride) * frame_info_.height)
+        return false; // The JPEG-LS encoder requires complete rows.
+
+    check_parameters();
+    source_stride_ = locked->stride;
+    locked_source_ = std::move(locked);
+    received_line_count_ = frame_info_.height;
+    return true;
+}
+
+// Completes a frame that is encoded after all lines are received (called by Commit and EstimateSize).
+void jpegls_bitmap_frame_encode::prepare_frame()
+{
+    if (frame_prepared_)
+        return;
+
+    frame_prepared_ = true;
+    if (detect_significant_bits())
+    {
+        reduce_bit_depth();
+    }
+
+    if (redundant_ && redundant_->any())
+    {
+        reduce_components();
+    }
+
+    if (options_.select_parameters())
+    {
+        select_parameters(pixels(), frame_info_.height);
+    }
+}
+
+// Left-aligned samples (unused low bits) are shifted right, right-aligned samples (unused high bits) are encoded with the
+// bit depth of the largest sample and marked in an application data segment: the decoder doesn't shift them left.
+// At least 9 bits are kept: the decoder then returns the 16 bit pixel format of the source.
+void jpegls_bitmap_frame_encode::reduce_bit_depth()
+{
+    constexpr int32_t minimum_bits_per_sample{9};
+    if (sample_bits_ == 0)
+        return; // All samples are 0.
+
+    if (const int32_t unused_low_bits{std::countr_zero(sample_bits_)}; unused_low_bits != 0)
+    {
+        const int32_t shift{std::min(unused_low_bits, 16 - minimum_bits_per_sample)};
+        const size_t sample_count{static_cast<size_t>(frame_info_.width) * frame_info_.component_count};
+        for (uint32_t line{}; line != frame_info_.height; ++line)
+        {
+            std::byte* row{source_->data() + (static_cast<size_t>(line) * source_stride_)};
+            copy_shift_right(row, row, sample_count, static_cast<uint32_t>(shift));
+        }
+        frame_info_.bits_per_sample = 16 - shift;
+    }
+    else
+    {
+        frame_info_.bits_per_sample = std::max(static_cast<int32_t>(std::bit_width(sample_bits_)), minimum_bits_per_sample);
+        right_aligned_ = frame_info_.bits_per_sample != 16;
+    }
+
+    TRACE("{} jpegls_bitmap_frame_encode::reduce_bit_depth, bits_per_sample={}, right_aligned={}\n", fmt::ptr(this),
+          frame_info_.bits_per_sample, right_aligned_);
+    check_parameters(); // The maximum NEAR value depends on the bit depth.
+}
+
+// Removes the redundant components from the pixel buffer (in place, the rows only shrink). The source components are
+// stored in the encoded image, the decoder restores them. Neutral pixels with varying alpha are encoded as gray + alpha,
+// which the decoder always returns as RGBA.
+void jpegls_bitmap_frame_encode::reduce_components()
+{
+    const int32_t component_count{frame_info_.component_count};
+    int32_t reduced_count{component_count};
+    if (redundant_->neutral && (component_count == 3 || redundant_->constant_alpha))
+    {
+        reduced_count = 1;
+    }
+    else if (redundant_->neutral)
+    {
+        reduced_count = 2;
+    }
+    else if (redundant_->constant_alpha)
+    {
+        reduced_count = 3;
+    }
+
+    if (reduced_count == component_count)
+        return;
+
+    const uint32_t stride{source_stride_};
+    frame_info_.component_count = reduced_count;
+    source_stride_ = compute_stride();
+    for (uint32_t line{}; line != frame_info_.height; ++line)
+    {
+        const std::byte* source_row{source_->data() + (static_cast<size_t>(line) * stride)};
+        std::byte* destination_row{source_->data() + (static_cast<size_t>(line) * source_stride_)};
+        if (reduced_count == 2)
+        {
+            extract_gray_alpha(source_row, destination_row, frame_info_.width);
+        }
+        else
+        {
+            remove_components(source_row, destination_row, frame_info_.width, static_cast<size_t>(component_count),
+                              static_cast<size_t>(reduced_count));
+        }
+    }
+
+    if (reduced_count != 2)
+    {
+        source_components_ = original_components{.component_count = component_count, .alpha = redundant_->alpha};
+    }
+    TRACE("{} jpegls_bitmap_frame_encode::reduce_components, component_count={}, reduced_count={}\n", fmt::ptr(this),
+          component_count, reduced_count);
+}
+
+// Note: in streaming mode the parameters are selected with the lines of the first stripe.
+void jpegls_bitmap_frame_encode::select_parameters(const std::span<const std::byte> source, const uint32_t line_count)
+{
+    auto selected{parameters()};
+    if (options_.target_size != 0 && !indexed() && !bilevel()) // Indices and bilevel pixels are always lossless.
+    {
+        selected.near_lossless = select_near_lossless(selected, source, source_stride_, line_count, options_.target_size);
+    }
+
+    if (options_.auto_parameters && !bilevel()) // The preset coding parameters of bilevel images define MAXVAL 1.
+    {
+        const bool allow_interleave_none{!stripe_encoder_ && restart_interval() == 0};
+        selected = ::select_parameters(selected, source, source_stride_, line_count, allow_interleave_none);
+    }
+
+    TRACE("{} jpegls_bitmap_frame_encode::select_parameters, near_lossless={}, interleave_mode={}, "
+          "color_transformation={}\n",
+          fmt::ptr(this), selected.near_lossless, static_cast<int32_t>(selected.interleave_mode),
+          static_cast<int32_t>(selected.color_transformation));
+
+    selected_parameters_ = selected;
+    if (stripe_encoder_)
+    {
+        stripe_encoder_.emplace(selected, stripe_encoder_->stripe_height());
+    }
+}
+
+void jpegls_bitmap_frame_encode::write_stripe()
+{
+    // Limits the memory use when the producer delivers lines faster than they can be encoded.
+    constexpr size_t maximum_pending_stripe_count{2};
+
+    if (stripe_index_ == 0 && options_.select_parameters())
+    {
+        select_parameters({source_->data(), source_->size()}, stripe_encoder_->line_count(0));
+    }
+
+    const uint32_t stripe_index{stripe_index_++};
+    storage_buffer pixels{std::move(*source_)};
+    source_.reset();
+    if (stripe_index_ != stripe_encoder_->stripe_count())
+    {
+        source_.emplace(buffer_pool_.acquire(pixels.size()));
+    }
+
+    encoding_stripes_.push_back(std::async(std::launch::async, [this, stripe_index, pixels = std::move(pixels)]() mutable {
+        auto encoded{stripe_encoder_->encode_stripe(stripe_index, {pixels.data(), pixels.size()}, source_stride_)};
+        buffer_pool_.release(std::move(pixels));
+        return encoded;
+    }));
+
+    write_encoded_stripes(maximum_pending_stripe_count);
+}
+
+// Writes the stripes that are already encoded and waits until no more than maximum_pending_count stripes are pending.
+// Note: IStream::Write is only called from the thread that called the frame, as the stream may not be thread-safe.
+void jpegls_bitmap_frame_encode::write_encoded_stripes(const size_t maximum_pending_count)
+{
+    while (!encoding_stripes_.empty() &&
+           (encoding_stripes_.size() > maximum_pending_count ||
+            encoding_stripes_.front().wait_for(std::chrono::seconds::zero()) == std::future_status::ready))
+    {
+        const auto encoded{encoding_stripes_.front().get()};
+        encoding_stripes_.pop_front();
+        write_to_stream(*destination_, encoded.bytes());
+    }
 }
@@ -12,38 +12,88 @@ import <win.hpp>;
 import winrt_base;
 import charls;
 
+import buffer_pool;
+import encoder_options;
+import hresults;
+import original_components;
+import pixel_conversion;
+import size_estimation;
+import storage_buffer;
+import stripe_encoder;
+import util;
 import "macros.hpp";
 
 using std::int32_t;
 using std::uint32_t;
 
-export struct jpegls_bitmap_frame_encode : winrt::implements<jpegls_bitmap_frame_encode, IWICBitmapFrameEncode>
+export struct jpegls_bitmap_frame_encode
+    : winrt::implements<jpegls_bitmap_frame_encode, IWICBitmapFrameEncode, IJpegLsSizeEstimation>
 {
+    // Note: with WICBitmapEncoderNoCache the frame writes the encoded stripes directly to the destination stream.
+    jpegls_bitmap_frame_encode(IStream* destination, WICBitmapEncoderCacheOption cache_option);
+
     [[nodiscard]]
-    const charls::frame_info& frame_info() const noexcept
+    encoding_parameters parameters() const noexcept
     {
-        ASSERT(state_ == state::commited);
-        return frame_info_;
+        ASSERT(size_set_ && pixel_format_set_);
+        if (selected_parameters_)
+            return *selected_parameters_;
+
+        const auto interleave_mode{frame_info_.component_count > 1
+                                       ? options_.interleave_mode.value_or(charls::interleave_mode::sample)
+                                       : charls::interleave_mode::none};
+
+        // The color transformations are defined for interleaved RGB images with 8 or 16 bit samples.
+        const bool color_transformation_allowed{
+            frame_info_.component_count == 3 && interleave_mode != charls::interleave_mode::none &&
+            (frame_info_.bits_per_sample == 8 || frame_info_.bits_per_sample == 16)};
+
+        return {.frame_info = frame_info_,
+                .interleave_mode = interleave_mode,
+                .near_lossless = options_.near_lossless,
+                .color_transformation =
+                    color_transformation_allowed ? options_.color_transformation : charls::color_transformation::none,
+                .preset_coding_parameters = {bilevel() ? 1 : 0, 0, 0, 0, 0}, // MAXVAL 1: bilevel image.
+                .spiff_header = options_.spiff_header,
+                .resolution = resolution_,
+                .source_components = source_components_,
+                .palette = indexed() ? palette_ : std::nullopt,
+                .right_aligned = right_aligned_};
     }
 
     [[nodiscard]]
-    const std::vector<std::byte>& source() const noexcept
+    bool streamed() const noexcept
     {
         ASSERT(state_ == state::commited);
-        return source_;
+        return stripe_encoder_.has_value();
     }
 
     [[nodiscard]]
-    const auto& resolution() const noexcept
+    std::span<const std::byte> source() const noexcept
+    {
+        ASSERT(state_ == state::commited && !stripe_encoder_);
+        return pixels();
+    }
+
+    // Called by the encoder after the frame is written: releases the lock on the source bitmap and the pixel buffer.
+    void release_source() noexcept
     {
         ASSERT(state_ == state::commited);
-        return resolution_;
+        locked_source_.reset();
+        source_.reset();
+    }
+
+    // Returns the number of lines between restart markers, 0 when the frame is encoded without restart markers.
+    [[nodiscard]]
+    uint32_t restart_interval() const noexcept
+    {
+        return std::min(options_.restart_interval, frame_info_.height);
     }
 
     [[nodiscard]]
     uint32_t source_stride() const noexcept
     {
-        ASSERT(state_ == state::commited);
+        ASSERT(state_ == state::commited && !stripe_encoder_);
         return source_stride_;
     }
 
@@ -60,21 +110,65 @@ export struct jpegls_bitmap_frame_encode : winrt::implements<jpegls_bitmap_frame
     HRESULT __stdcall Commit() noexcept override;
     HRESULT __stdcall SetPalette(IWICPalette* palette) noexcept override;
 
+    // IJpegLsSizeEstimation
+    HRESULT __stdcall EstimateSize(ULONGLONG* estimated_size, ULONGLONG* error_bound) noexcept override;
+
 private:
-    void set_pixel_format(const int32_t bits_per_sample, const int32_t component_count) noexcept
+    void set_pixel_format(const GUID& pixel_format, const int32_t bits_per_sample, const int32_t component_count) noexcept
     {
+        pixel_format_ = pixel_format;
         frame_info_.bits_per_sample = bits_per_sample;
         frame_info_.component_count = component_count;
         pixel_format_set_ = true;
+
+        // Left-aligned samples with fewer significant bits are shifted right while they are copied.
+        sample_shift_ = 0;
+        if (bits_per_sample == 16 && options_.significant_bits != 0)
+        {
+            frame_info_.bits_per_sample = options_.significant_bits;
+            sample_shift_ = static_cast<uint32_t>(16 - options_.significant_bits);
+        }
     }
 
+    void check_parameters() const
+    {
+        // JPEG-LS limits the NEAR parameter to half the maximum sample value.
+        const int32_t maximum_sample_value{bilevel() ? 1 : (1 << frame_info_.bits_per_sample) - 1};
+        const int32_t maximum_near_lossless{std::min(255, maximum_sample_value / 2)};
+        check_condition(options_.near_lossless <= maximum_near_lossless, error_invalid_argument);
+
+        // The samples of an indexed image are palette indices: only lossless encoding preserves them.
+        if (indexed())
+        {
+            check_condition(palette_.has_value(), wincodec::error_palette_unavailable);
+            check_condition(options_.near_lossless == 0, error_invalid_argument);
+        }
+
+        // Restart markers are inserted by stitching stripes, which requires 1 scan for all components.
+        check_condition(restart_interval() == 0 || stripe_encoder::can_encode(parameters()), error_invalid_argument);
+    }
+
+    // In streaming mode the pixel buffer holds the lines of 1 stripe, otherwise the complete image.
+    // The pixels are stored in the layout of the JPEG-LS encoder: RGB(A) component order, 1 byte per 1, 2 or 4 bit
+    // sample.
     void allocate_pixel_buffer()
     {
         ASSERT(size_set_ && pixel_format_set_);
-        if (source_.empty())
+        if (!source_ && !stripe_encoder_)
         {
-            source_stride_ = compute_stride();
-            source_.resize(source_stride_ * frame_info_.height);
+            check_parameters();
+            source_stride_ = packed_pixels() ? frame_info_.width : compute_stride();
+
+            uint32_t line_count{frame_info_.height};
+            if (destination_ && stripe_encoder::can_encode(parameters()))
+            {
+                stripe_encoder_.emplace(parameters(), restart_interval() != 0
+                                                          ? restart_interval()
+                                                          : stripe_encoder::default_stripe_height(frame_info_));
+                line_count = stripe_encoder_->stripe_height();
+            }
+
+            source_.emplace(buffer_pool_.acquire(static_cast<size_t>(source_stride_) * line_count));
         }
     }
 
@@ -82,16 +176,16 @@ private:
     uint32_t compute_stride() const noexcept
     {
         ASSERT(size_set_ && pixel_format_set_);
-        return compute_stride(frame_info_);
+        return compute_stride(frame_info_, bits_per_pixel_sample());
     }
 
     [[nodiscard]]
-    static uint32_t compute_stride(const charls::frame_info& frame_info) noexcept
+    static uint32_t compute_stride(const charls::frame_info& frame_info, const int32_t bits_per_sample) noexcept
     {
         uint32_t stride;
-        if (frame_info.bits_per_sample <= 8)
+        if (bits_per_sample <= 8)
         {
-            const uint32_t samples_per_byte{8U / frame_info.bits_per_sample};
+            const uint32_t samples_per_byte{8U / bits_per_sample};
             stride = ((frame_info.width * frame_info.component_count) + (samples_per_byte - 1)) / samples_per_byte;
         }
         else
@@ -104,83 +198,100 @@ private:
         return ((stride + (alignment - 1)) / alignment) * alignment;
     }
 
-    void convert_bgr_to_rgb(const size_t component_count) noexcept
+    [[nodiscard]]
+    bool indexed() const noexcept
     {
-        ASSERT(component_count == 3 || component_count == 4);
+        return pixel_format_ == GUID_WICPixelFormat8bppIndexed;
+    }
 
-        for (size_t i{}; i < source_.size(); i += component_count)
-        {
-            std::swap(source_[i], source_[i + 2]);
-        }
+    // Bilevel pixels are encoded as 2 bit samples with a maximum sample value (MAXVAL) of 1.
+    [[nodiscard]]
+    bool bilevel() const noexcept
+    {
+        return pixel_format_ == GUID_WICPixelFormatBlackWhite;
     }
 
-    void unpack_crumbs()
+    // The number of bits of a sample in the pixel format of the source.
+    [[nodiscard]]
+    int32_t bits_per_pixel_sample() const noexcept
     {
-        const std::byte* crumbs_pixels{source_.data()};
-        const size_t stride{source_stride_};
-        const size_t width{frame_info_.width};
-        const size_t height{frame_info_.height};
-        std::vector<std::byte> unpacked(width * height);
+        return bilevel() ? 1 : frame_info_.bits_per_sample;
+    }
 
-        for (size_t j{}, row{}; row != height; ++row)
-        {
-            const std::byte* crumbs_row{crumbs_pixels + (row * stride)};
-            size_t i{};
-            for (; i != width / 4; ++i)
-            {
-                unpacked[j++] = crumbs_row[i] >> 6;
-                unpacked[j++] = (crumbs_row[i] & std::byte{0x30}) >> 4;
-                unpacked[j++] = (crumbs_row[i] & std::byte{0x0C}) >> 2;
-                unpacked[j++] = crumbs_row[i] & std::byte{0x03};
-            }
-            switch (width % 4)
-            {
-            case 3:
-                unpacked[j++] = crumbs_row[i] >> 6;
-                [[fallthrough]];
-            case 2:
-                unpacked[j++] = (crumbs_row[i] & std::byte{0x30}) >> 4;
-                [[fallthrough]];
-            case 1:
-                unpacked[j++] = (crumbs_row[i] & std::byte{0x0C}) >> 2;
-                break;
-
-            default:
-                break;
-            }
-        }
+    // 1, 2 and 4 bit pixels are unpacked to 1 sample per byte when they are copied to the pixel buffer.
+    [[nodiscard]]
+    bool packed_pixels() const noexcept
+    {
+        return frame_info_.bits_per_sample < 8;
+    }
 
-        source_.swap(unpacked);
-        source_stride_ = 0; // JPEG-LS encoder should re-compute the stride
+    // The significant bits are detected when the complete frame is encoded after all lines are received.
+    [[nodiscard]]
+    bool detect_significant_bits() const noexcept
+    {
+        return options_.auto_significant_bits && options_.significant_bits == 0 && frame_info_.bits_per_sample == 16 &&
+               !stripe_encoder_;
     }
 
-    void unpack_nibbles()
+    // 16 bit samples are shifted or analyzed while they are copied.
+    [[nodiscard]]
+    bool convert_samples() const noexcept
     {
-        const std::byte* nibble_pixels{source_.data()};
-        const size_t stride{source_stride_};
-        const size_t width{frame_info_.width};
-        const size_t height{frame_info_.height};
-        std::vector<std::byte> unpacked(width * height);
+        return sample_shift_ != 0 || detect_significant_bits();
+    }
 
-        for (size_t j{}, row{}; row != height; ++row)
-        {
-            const std::byte* nibble_row{nibble_pixels + (row * stride)};
-            size_t i{};
-            for (; i != width / 2; ++i)
-            {
-                unpacked[j++] = nibble_row[i] >> 4;
-                unpacked[j++] = nibble_row[i] & std::byte{0x0F};
-            }
-            if (width % 2)
-            {
-                unpacked[j++] = nibble_row[i] >> 4;
-            }
-        }
+    // Redundant components are detected when the complete frame is encoded after all lines are received.
+    [[nodiscard]]
+    bool detect_redundant_components() const noexcept
+    {
+        return options_.reduce_components && frame_info_.bits_per_sample == 8 && frame_info_.component_count >= 3 &&
+               !stripe_encoder_;
+    }
 
-        source_.swap(unpacked);
-        source_stride_ = 0; // JPEG-LS encoder should re-compute the stride
+    // The pixels are converted or analyzed while they are copied to the pixel buffer.
+    [[nodiscard]]
+    bool copy_converts_pixels() const noexcept
+    {
+        return swap_pixels_ || packed_pixels() || convert_samples() || detect_redundant_components();
     }
 
+    void copy_lines(const std::byte* source, uint32_t source_stride, std::byte* destination, uint32_t line_count) noexcept;
+    void copy_source_lines(IWICBitmapSource& bitmap_source, const WICRect& area, uint32_t first_line, uint32_t line_count,
+                           std::byte* destination);
+
+    template<typename CopyLines>
+    void receive_lines(uint32_t line_count, CopyLines copy);
+
+    // Pixels of a bitmap that are read directly from its memory.
+    struct locked_pixels final
+    {
+        winrt::com_ptr<IWICBitmapLock> lock;
+        std::span<const std::byte> pixels;
+        uint32_t stride;
+    };
+
+    [[nodiscard]]
+    std::optional<locked_pixels> lock_pixels(IWICBitmapSource& bitmap_source, const WICRect& rectangle) const;
+
+    [[nodiscard]]
+    bool use_locked_source(IWICBitmapSource& bitmap_source, const WICRect& area);
+
+    [[nodiscard]]
+    std::span<const std::byte> pixels() const noexcept
+    {
+        if (locked_source_)
+            return locked_source_->pixels;
+
+        return {source_->data(), source_->size()};
+    }
+
+    void prepare_frame();
+    void reduce_bit_depth();
+    void reduce_components();
+    void select_parameters(std::span<const std::byte> source, uint32_t line_count);
+    void write_stripe();
+    void write_encoded_stripes(size_t maximum_pending_count);
+
     enum class state
     {
         created,
@@ -193,9 +304,29 @@ private:
     bool size_set_{};
     bool pixel_format_set_{};
     std::optional<std::pair<uint32_t, uint32_t>> resolution_;
+    encoder_options options_;
+    std::optional<encoding_parameters> selected_parameters_; // Set when the parameters are selected by trial encodes.
+    GUID pixel_format_{};
     bool swap_pixels_{};
+    uint32_t sample_shift_{};
+    std::uint16_t sample_bits_{}; // Bitwise OR of the received samples, when the significant bits are detected.
+    bool right_aligned_{};        // The samples are encoded with the bit depth of the largest sample, unshifted.
+    std::optional<redundant_components> redundant_; // Set when redundant components are detected.
+    std::optional<original_components> source_components_; // Set when the redundant components are removed.
+    std::optional<mapping_table> palette_;
+    bool frame_prepared_{};
     uint32_t received_line_count_{};
     uint32_t source_stride_{};
-    std::vector<std::byte> source_;
+    std::optional<storage_buffer> source_;
+    std::optional<locked_pixels> locked_source_; // The complete frame in the memory of a locked bitmap (no copy).
     charls::frame_info frame_info_{};
+    winrt::com_ptr<IStream> destination_;
+    std::optional<stripe_encoder> stripe_encoder_;
+    uint32_t stripe_index_{};
+    buffer_pool buffer_pool_; // Stripe and staging pixel buffers, also used by the worker threads.
+
+    // Stripes are encoded by worker threads while the caller delivers the next lines, the encoded
+    // stripes are written (in order) to the destination by the calling thread.
+    // Note: declared last, destroying the futures waits for the workers, which use the other members.
+    std::deque<std::future<encoded_data>> encoding_stripes_;
 };
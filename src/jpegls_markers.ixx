@@ -0,0 +1,129 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module jpegls_markers;
+
+import std;
+
+import util;
+
+using std::size_t;
+using std::span;
+using std::uint32_t;
+
+// The JPEG-LS markers and marker segment fields that are used to stitch (encoder) and split (decoder) encoded images.
+export constexpr std::byte marker_start{0xFF_byte};
+export constexpr std::byte start_of_image{0xD8_byte};
+export constexpr std::byte end_of_image_marker{0xD9_byte};
+export constexpr std::byte start_of_scan{0xDA_byte};
+export constexpr std::byte define_restart_interval{0xDD_byte};
+export constexpr std::byte start_of_frame_jpegls{0xF7_byte};
+export constexpr std::byte application_data8{0xE8_byte};
+export constexpr std::byte restart_marker0{0xD0_byte};
+export constexpr uint32_t restart_marker_range{8};
+
+export constexpr size_t frame_height_offset{5};  // Offset of the Y field in the SOF55 segment.
+export constexpr size_t spiff_height_offset{14}; // Offset of the height field in the SPIFF header (APP8 segment).
+export constexpr std::array spiff_magic_id{std::byte{'S'}, std::byte{'P'}, std::byte{'I'}, std::byte{'F'}, std::byte{'F'},
+                                           0_byte};
+
+export constexpr std::array end_of_image_bytes{marker_start, end_of_image_marker};
+
+export [[nodiscard]]
+size_t read_uint16(const std::byte* bytes) noexcept
+{
+    return (std::to_integer<size_t>(bytes[0]) << 8) | std::to_integer<size_t>(bytes[1]);
+}
+
+export void write_uint16(std::byte* bytes, const uint32_t value) noexcept
+{
+    bytes[0] = static_cast<std::byte>(value >> 8);
+    bytes[1] = static_cast<std::byte>(value);
+}
+
+export void write_uint32(std::byte* bytes, const uint32_t value) noexcept
+{
+    write_uint16(bytes, value >> 16);
+    write_uint16(bytes + 2, value);
+}
+
+// The positions of the segments in front of the entropy coded data of the first scan.
+export struct scan_position final
+{
+    size_t start_of_scan;
+    size_t entropy_coded_data;
+    std::optional<size_t> start_of_frame;
+    std::optional<size_t> spiff_header;
+    uint32_t restart_interval; // 0 when the image has no DRI segment.
+};
+
+// Purpose: walks the marker segments of an encoded image and returns the position of the first SOS segment.
+// Returns no value when the segments are truncated or no SOS segment is found.
+export [[nodiscard]]
+std::optional<scan_position> find_first_scan(const span<const std::byte> encoded) noexcept
+{
+    scan_position position{};
+    size_t segment{};
+    while (segment + 4 <= encoded.size())
+    {
+        if (encoded[segment] != marker_start)
+            return {};
+
+        const std::byte marker{encoded[segment + 1]};
+        if (marker == start_of_image)
+        {
+            segment += 2;
+            continue;
+        }
+
+        const size_t segment_size{2 + read_uint16(&encoded[segment + 2])};
+        if (segment + segment_size > encoded.size())
+            return {};
+
+        if (marker == start_of_scan)
+        {
+            position.start_of_scan = segment;
+            position.entropy_coded_data = segment + segment_size;
+            return position;
+        }
+
+        if (marker == start_of_frame_jpegls && segment_size >= frame_height_offset + 2)
+        {
+            position.start_of_frame = segment;
+        }
+        else if (marker == application_data8 && segment_size > spiff_height_offset + 4 &&
+                 std::ranges::equal(encoded.subspan(segment + 4, spiff_magic_id.size()), spiff_magic_id))
+        {
+            position.spiff_header = segment;
+        }
+        else if (marker == define_restart_interval && segment_size >= 6 && segment_size <= 8)
+        {
+            // The restart interval field has 2, 3 or 4 bytes (JPEG-LS extends the DRI segment of JPEG).
+            position.restart_interval = 0;
+            for (size_t i{4}; i != segment_size; ++i)
+            {
+                position.restart_interval =
+                    (position.restart_interval << 8) | std::to_integer<uint32_t>(encoded[segment + i]);
+            }
+        }
+
+        segment += segment_size;
+    }
+
+    return {};
+}
+
+// Purpose: updates the height fields of the SOF55 segment and the SPIFF header (when present).
+export void set_frame_height(const span<std::byte> encoded, const scan_position& position,
+                             const uint32_t frame_height) noexcept
+{
+    if (position.start_of_frame)
+    {
+        write_uint16(&encoded[*position.start_of_frame + frame_height_offset], frame_height);
+    }
+
+    if (position.spiff_header)
+    {
+        write_uint32(&encoded[*position.spiff_header + spiff_height_offset], frame_height);
+    }
+}
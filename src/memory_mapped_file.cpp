@@ -0,0 +1,92 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+module memory_mapped_file;
+
+import std;
+
+#ifdef _WIN32
+import winrt_base;
+import <win.hpp>;
+#endif
+
+using std::span;
+
+#ifdef _WIN32
+
+std::optional<memory_mapped_file> memory_mapped_file::open(const std::filesystem::path& path) noexcept
+{
+    const winrt::file_handle file{CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr)};
+    if (!file)
+        return {};
+
+    // Empty files cannot be mapped.
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file.get(), &size) || size.QuadPart == 0 ||
+        static_cast<std::uint64_t>(size.QuadPart) > std::numeric_limits<size_t>::max())
+        return {};
+
+    const winrt::handle mapping{CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr)};
+    if (!mapping)
+        return {};
+
+    // The view keeps the mapping and the file alive: the handles can be closed.
+    const void* view{MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0)};
+    if (!view)
+        return {};
+
+    return memory_mapped_file{span{static_cast<const std::byte*>(view), static_cast<size_t>(size.QuadPart)}};
+}
+
+memory_mapped_file::~memory_mapped_file()
+{
+    if (!view_.empty())
+    {
+        UnmapViewOfFile(view_.data());
+    }
+}
+
+#else
+
+std::optional<memory_mapped_file> memory_mapped_file::open(const std::filesystem::path& path) noexcept
+{
+    const int file{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (file == -1)
+        return {};
+
+    struct stat status{};
+    void* view{MAP_FAILED};
+    if (fstat(file, &status) == 0 && status.st_size > 0)
+    {
+        view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    }
+
+    // The mapping keeps the file alive: the descriptor can be closed.
+    close(file);
+    if (view == MAP_FAILED)
+        return {};
+
+    return memory_mapped_file{span{static_cast<const std::byte*>(view), static_cast<size_t>(status.st_size)}};
+}
+
+memory_mapped_file::~memory_mapped_file()
+{
+    if (!view_.empty())
+    {
+        munmap(const_cast<std::byte*>(view_.data()), view_.size());
+    }
+}
+
+#endif
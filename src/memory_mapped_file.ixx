@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module memory_mapped_file;
+
+import std;
+
+// Purpose: read-only view of the complete content of a file, mapped in the address space of the process.
+// The pages are shared with the file system cache: no copy of the file content is made.
+export class memory_mapped_file final
+{
+public:
+    // Returns no value when the file cannot be opened or mapped, the caller should then read the file.
+    // Windows: the file is opened without write sharing, mapping fails when the file is opened for writing.
+    [[nodiscard]]
+    static std::optional<memory_mapped_file> open(const std::filesystem::path& path) noexcept;
+
+    ~memory_mapped_file();
+
+    memory_mapped_file(const memory_mapped_file&) = delete;
+    memory_mapped_file& operator=(const memory_mapped_file&) = delete;
+
+    memory_mapped_file(memory_mapped_file&& other) noexcept : view_{std::exchange(other.view_, {})}
+    {
+    }
+
+    memory_mapped_file& operator=(memory_mapped_file&&) = delete;
+
+    [[nodiscard]]
+    std::span<const std::byte> bytes() const noexcept
+    {
+        return view_;
+    }
+
+private:
+    explicit memory_mapped_file(const std::span<const std::byte> view) noexcept : view_{view}
+    {
+    }
+
+    std::span<const std::byte> view_;
+};
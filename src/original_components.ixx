@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module original_components;
+
+import std;
+
+// The components of the source of an 8 bit image that is encoded with fewer components (opaque RGBA => RGB, neutral
+// RGB(A) => gray). Stored in an application data segment, the decoder restores the pixel format of the source.
+export struct original_components final
+{
+    std::int32_t component_count; // 3 (RGB) or 4 (RGBA)
+    std::byte alpha;              // Value of the removed alpha component of 4 component sources.
+
+    static constexpr std::int32_t application_data_id{9}; // APP9
+
+    [[nodiscard]]
+    std::array<std::byte, 13> to_application_data() const noexcept
+    {
+        std::array<std::byte, 13> data{};
+        std::ranges::copy(identifier, data.begin());
+        data[identifier.size()] = static_cast<std::byte>(component_count);
+        data[identifier.size() + 1] = alpha;
+        return data;
+    }
+
+    // Returns no value when the data is not an original components segment (other applications also use APPn).
+    [[nodiscard]]
+    static std::optional<original_components> from_application_data(const std::span<const std::byte> data) noexcept
+    {
+        if (data.size() != identifier.size() + 2 || !std::ranges::equal(data.first(identifier.size()), identifier))
+            return {};
+
+        const auto component_count{std::to_integer<std::int32_t>(data[identifier.size()])};
+        if (component_count != 3 && component_count != 4)
+            return {};
+
+        return original_components{.component_count = component_count, .alpha = data[identifier.size() + 1]};
+    }
+
+private:
+    static constexpr std::array identifier{std::byte{'j'}, std::byte{'p'}, std::byte{'e'}, std::byte{'g'},
+                                           std::byte{'l'}, std::byte{'s'}, std::byte{'-'}, std::byte{'w'},
+                                           std::byte{'i'}, std::byte{'c'}, std::byte{0}};
+};
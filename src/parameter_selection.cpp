@@ -0,0 +1,347 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+module parameter_selection;
+
+import std;
+import charls;
+
+import jpegls_markers;
+import stripe_encoder;
+import "macros.hpp";
+
+using charls::color_transformation;
+using charls::interleave_mode;
+using charls::jpegls_pc_parameters;
+using std::int32_t;
+using std::span;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+namespace {
+
+// 4 bands of 16 lines are sampled, spread over the image: enough to capture the character of the content, while the
+// trial encodes of all candidates remain a fraction of the time of a complete encode.
+constexpr uint32_t band_line_count{16};
+constexpr uint32_t selection_band_count{4};
+
+// The size estimate of 1 configuration uses more bands, to reduce the error of the estimate.
+constexpr uint32_t estimation_band_count{8};
+
+// Up to 8 NEAR values are estimated concurrently per round of the search.
+constexpr int32_t near_lossless_candidates_per_round{8};
+
+// A candidate that is cheaper to encode and decode is preferred when its size is within 1% of the smallest size.
+constexpr size_t size_tolerance_divisor{100};
+
+struct band final
+{
+    uint32_t first_line;
+    uint32_t line_count;
+};
+
+[[nodiscard]]
+vector<band> sample_bands(const uint32_t line_count, const uint32_t band_count)
+{
+    if (line_count <= band_line_count * band_count)
+        return {{.first_line = 0, .line_count = line_count}};
+
+    const uint32_t spacing{line_count / band_count};
+    vector<band> bands;
+    for (uint32_t i{}; i != band_count; ++i)
+    {
+        bands.push_back({.first_line = (i * spacing) + ((spacing - band_line_count) / 2), .line_count = band_line_count});
+    }
+
+    return bands;
+}
+
+[[nodiscard]]
+size_t trial_encode(const encoding_parameters& candidate, const span<const std::byte> source, const uint32_t stride,
+                    const vector<band>& bands)
+{
+    size_t size{};
+    for (const auto& [first_line, line_count] : bands)
+    {
+        size += encode(candidate, line_count, source.subspan(static_cast<size_t>(first_line) * stride), stride)
+                    .bytes()
+                    .size();
+    }
+
+    return size;
+}
+
+// Returns the size of the marker segments of an encoded image (SPIFF header, SOF, LSE, SOS and EOI). Every encoded band
+// contains them once: they are removed from the band sizes before these are scaled to the height of the image.
+[[nodiscard]]
+size_t header_size(const encoding_parameters& parameters, const span<const std::byte> source, const uint32_t stride)
+{
+    const auto encoded{encode(parameters, 1, source, stride)};
+    const auto scan{find_first_scan(encoded.bytes())};
+    ASSERT(scan);
+
+    // With interleave mode none every component has its own scan, the SOS segments have the same size.
+    const size_t scan_count{parameters.interleave_mode == interleave_mode::none
+                                ? static_cast<size_t>(parameters.frame_info.component_count)
+                                : 1};
+    return scan->entropy_coded_data + ((scan_count - 1) * (scan->entropy_coded_data - scan->start_of_scan)) +
+           end_of_image_bytes.size();
+}
+
+// Returns the encoded size of the sampled bands for every candidate, the candidates are encoded concurrently.
+[[nodiscard]]
+vector<size_t> trial_encode_concurrently(const vector<encoding_parameters>& candidates,
+                                         const span<const std::byte> source, const uint32_t stride,
+                                         const vector<band>& bands)
+{
+    vector<std::future<size_t>> trials;
+    trials.reserve(candidates.size());
+    for (const auto& candidate : candidates)
+    {
+        trials.push_back(std::async(std::launch::async, [&candidate, source, stride, &bands] {
+            return trial_encode(candidate, source, stride, bands);
+        }));
+    }
+
+    vector<size_t> sizes;
+    sizes.reserve(trials.size());
+    for (auto& trial : trials)
+    {
+        sizes.push_back(trial.get());
+    }
+
+    return sizes;
+}
+
+// The candidates are ordered from cheapest to most expensive to encode and decode.
+[[nodiscard]]
+encoding_parameters select_smallest(const vector<encoding_parameters>& candidates, const span<const std::byte> source,
+                                    const uint32_t stride, const vector<band>& bands)
+{
+    ASSERT(!candidates.empty());
+    if (candidates.size() == 1)
+        return candidates.front();
+
+    const auto sizes{trial_encode_concurrently(candidates, source, stride, bands)};
+    const size_t smallest_size{std::ranges::min(sizes)};
+    const size_t size_budget{smallest_size + (smallest_size / size_tolerance_divisor)};
+    const auto selected{std::ranges::find_if(sizes, [size_budget](const size_t size) { return size <= size_budget; })};
+    return candidates[static_cast<size_t>(selected - sizes.begin())];
+}
+
+// Default thresholds, as defined by ISO/IEC 14495-1, C.2.4.1.1.
+[[nodiscard]]
+jpegls_pc_parameters default_thresholds(const int32_t maximum_sample_value, const int32_t near_lossless) noexcept
+{
+    constexpr int32_t default_reset_value{64};
+
+    if (maximum_sample_value >= 128)
+    {
+        const int32_t factor{(std::min(maximum_sample_value, 4095) + 128) / 256};
+        const int32_t threshold1{
+            std::clamp((factor * (3 - 2)) + 2 + (3 * near_lossless), near_lossless + 1, maximum_sample_value)};
+        const int32_t threshold2{
+            std::clamp((factor * (7 - 3)) + 3 + (5 * near_lossless), threshold1, maximum_sample_value)};
+        const int32_t threshold3{
+            std::clamp((factor * (21 - 4)) + 4 + (7 * near_lossless), threshold2, maximum_sample_value)};
+        return {0, threshold1, threshold2, threshold3, default_reset_value};
+    }
+
+    const int32_t factor{256 / (maximum_sample_value + 1)};
+    const int32_t threshold1{
+        std::clamp(std::max(2, (3 / factor) + (3 * near_lossless)), near_lossless + 1, maximum_sample_value)};
+    const int32_t threshold2{
+        std::clamp(std::max(3, (7 / factor) + (5 * near_lossless)), threshold1, maximum_sample_value)};
+    const int32_t threshold3{
+        std::clamp(std::max(4, (21 / factor) + (7 * near_lossless)), threshold2, maximum_sample_value)};
+    return {0, threshold1, threshold2, threshold3, default_reset_value};
+}
+
+// Scaling keeps the order of the thresholds: near_lossless + 1 <= T1 <= T2 <= T3 <= MAXVAL.
+[[nodiscard]]
+jpegls_pc_parameters scale_thresholds(const jpegls_pc_parameters& thresholds, const int32_t numerator,
+                                      const int32_t denominator, const int32_t maximum_sample_value,
+                                      const int32_t near_lossless) noexcept
+{
+    const auto scale{[=](const int32_t threshold) {
+        return std::clamp(threshold * numerator / denominator, near_lossless + 1, maximum_sample_value);
+    }};
+
+    return {0, scale(thresholds.threshold1), scale(thresholds.threshold2), scale(thresholds.threshold3),
+            thresholds.reset_value};
+}
+
+[[nodiscard]]
+vector<encoding_parameters> interleave_candidates(const encoding_parameters& parameters, const bool allow_interleave_none)
+{
+    const auto& frame_info{parameters.frame_info};
+    if (frame_info.component_count == 1)
+        return {parameters};
+
+    // The color transformations are lossless transformations, only defined for 8 and 16 bit RGB.
+    const bool try_color_transformations{frame_info.component_count == 3 && parameters.near_lossless == 0 &&
+                                         (frame_info.bits_per_sample == 8 || frame_info.bits_per_sample == 16)};
+
+    vector<encoding_parameters> candidates;
+    for (const auto mode : {interleave_mode::sample, interleave_mode::line, interleave_mode::none})
+    {
+        if (mode == interleave_mode::none && !allow_interleave_none)
+            continue;
+
+        auto candidate{parameters};
+        candidate.interleave_mode = mode;
+        candidate.color_transformation = color_transformation::none;
+        candidates.push_back(candidate);
+
+        if (try_color_transformations && mode != interleave_mode::none)
+        {
+            for (const auto transformation :
+                 {color_transformation::hp1, color_transformation::hp2, color_transformation::hp3})
+            {
+                candidate.color_transformation = transformation;
+                candidates.push_back(candidate);
+            }
+        }
+    }
+
+    return candidates;
+}
+
+[[nodiscard]]
+vector<encoding_parameters> threshold_candidates(const encoding_parameters& parameters)
+{
+    const int32_t maximum_sample_value{(1 << parameters.frame_info.bits_per_sample) - 1};
+    const auto thresholds{default_thresholds(maximum_sample_value, parameters.near_lossless)};
+
+    // Lower thresholds suit smooth content (photos), higher thresholds noisy content.
+    auto lower{parameters};
+    lower.preset_coding_parameters =
+        scale_thresholds(thresholds, 1, 2, maximum_sample_value, parameters.near_lossless);
+    auto higher{parameters};
+    higher.preset_coding_parameters =
+        scale_thresholds(thresholds, 2, 1, maximum_sample_value, parameters.near_lossless);
+
+    return {parameters, lower, higher};
+}
+
+} // namespace
+
+encoding_parameters select_parameters(const encoding_parameters& parameters, const span<const std::byte> source,
+                                      const uint32_t stride, const uint32_t line_count, const bool allow_interleave_none)
+{
+    ASSERT(line_count > 0);
+    const auto bands{sample_bands(line_count, selection_band_count)};
+
+    // The SPIFF header has the same size for every candidate.
+    auto trial_parameters{parameters};
+    trial_parameters.spiff_header = false;
+    trial_parameters.preset_coding_parameters = {};
+
+    // The interleave mode and color transformation have the largest effect, the thresholds are tuned afterwards.
+    auto selected{select_smallest(interleave_candidates(trial_parameters, allow_interleave_none), source, stride, bands)};
+    selected = select_smallest(threshold_candidates(selected), source, stride, bands);
+
+    selected.spiff_header = parameters.spiff_header;
+    return selected;
+}
+
+int32_t select_near_lossless(const encoding_parameters& parameters, const span<const std::byte> source,
+                             const uint32_t stride, const uint32_t line_count, const uint64_t target_size)
+{
+    ASSERT(line_count > 0);
+    const auto bands{sample_bands(line_count, selection_band_count)};
+    const uint64_t sampled_line_count{std::ranges::fold_left(
+        bands, uint64_t{}, [](const uint64_t count, const band& sampled) { return count + sampled.line_count; })};
+
+    auto trial_parameters{parameters};
+    trial_parameters.spiff_header = false;
+    const size_t band_header_size{header_size(trial_parameters, source, stride) * bands.size()};
+    const size_t image_header_size{header_size(parameters, source, stride)};
+
+    // The estimated size decreases when NEAR increases: every round narrows the interval (too_large, fits] with the
+    // estimates of evenly spaced values inside the interval.
+    const int32_t maximum_near_lossless{std::min(255, ((1 << parameters.frame_info.bits_per_sample) - 1) / 2)};
+    int32_t too_large{-1};
+    int32_t fits{maximum_near_lossless + 1}; // No value is known that meets the target size.
+    while (fits - too_large > 1)
+    {
+        const int32_t interval{fits - too_large};
+        const int32_t count{std::min(near_lossless_candidates_per_round, interval - 1)};
+
+        vector<encoding_parameters> candidates;
+        for (int32_t i{1}; i <= count; ++i)
+        {
+            trial_parameters.near_lossless = too_large + (i * interval / (count + 1));
+            candidates.push_back(trial_parameters);
+        }
+
+        const auto sizes{trial_encode_concurrently(candidates, source, stride, bands)};
+        for (size_t i{}; i != candidates.size(); ++i)
+        {
+            const uint64_t estimated_size{
+                ((sizes[i] - std::min(sizes[i], band_header_size)) * uint64_t{parameters.frame_info.height} /
+                 sampled_line_count) +
+                image_header_size};
+            if (estimated_size <= target_size)
+            {
+                fits = candidates[i].near_lossless;
+                break;
+            }
+
+            too_large = candidates[i].near_lossless;
+        }
+    }
+
+    return std::min(fits, maximum_near_lossless);
+}
+
+size_estimate estimate_size(const encoding_parameters& parameters, const span<const std::byte> source,
+                            const uint32_t stride)
+{
+    const uint32_t line_count{parameters.frame_info.height};
+    const auto bands{sample_bands(line_count, estimation_band_count)};
+    if (bands.size() == 1)
+        return {.size = encode(parameters, line_count, source, stride).bytes().size(), .error_bound = 0};
+
+    auto trial_parameters{parameters};
+    trial_parameters.spiff_header = false;
+
+    vector<std::future<size_t>> band_sizes;
+    band_sizes.reserve(bands.size());
+    for (const auto& sampled : bands)
+    {
+        band_sizes.push_back(std::async(std::launch::async, [&trial_parameters, source, stride, &sampled] {
+            return trial_encode(trial_parameters, source, stride, {sampled});
+        }));
+    }
+
+    // Every band (without its marker segments) is a sample of the encoded size per line.
+    const size_t band_header_size{header_size(trial_parameters, source, stride)};
+    vector<double> sizes_per_line;
+    sizes_per_line.reserve(bands.size());
+    for (size_t i{}; i != bands.size(); ++i)
+    {
+        const size_t band_size{band_sizes[i].get()};
+        sizes_per_line.push_back(static_cast<double>(band_size - std::min(band_size, band_header_size)) /
+                                 bands[i].line_count);
+    }
+
+    const auto sample_count{static_cast<double>(sizes_per_line.size())};
+    const double mean{std::ranges::fold_left(sizes_per_line, 0.0, std::plus{}) / sample_count};
+    const double variance{std::ranges::fold_left(sizes_per_line, 0.0,
+                                                 [mean](const double sum, const double size) {
+                                                     return sum + ((size - mean) * (size - mean));
+                                                 }) /
+                          (sample_count - 1)};
+
+    // The standard error includes the finite population correction, the bound is 2 standard errors (about 95%).
+    const double population_count{static_cast<double>(line_count) / band_line_count};
+    const double standard_error{std::sqrt(variance / sample_count * (1 - (sample_count / population_count)))};
+    return {.size = static_cast<uint64_t>(std::llround(mean * line_count)) + header_size(parameters, source, stride),
+            .error_bound = static_cast<uint64_t>(std::llround(2 * standard_error * line_count))};
+}
@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module parameter_selection;
+
+import std;
+
+import stripe_encoder;
+
+using std::uint32_t;
+
+// Purpose: selects the interleave mode, color transformation and preset coding parameters (T1, T2, T3, RESET) that
+// give the smallest encoded size, by trial-encoding sampled bands of lines with every candidate configuration.
+// The candidates are encoded concurrently; the complete image is encoded once afterwards with the selected parameters.
+// When allow_interleave_none is false, images with multiple components only use interleaved candidates (required to
+// encode the image in stripes).
+export [[nodiscard]]
+encoding_parameters select_parameters(const encoding_parameters& parameters, std::span<const std::byte> source,
+                                      uint32_t stride, uint32_t line_count, bool allow_interleave_none);
+
+// Purpose: returns the smallest NEAR value for which the estimated encoded size of the complete image (the height of
+// parameters.frame_info) does not exceed target_size, or the maximum NEAR value when no value meets the target.
+// The size is estimated by encoding sampled bands of the available lines, the NEAR values are estimated concurrently.
+export [[nodiscard]]
+std::int32_t select_near_lossless(const encoding_parameters& parameters, std::span<const std::byte> source,
+                                  uint32_t stride, uint32_t line_count, std::uint64_t target_size);
+
+export struct size_estimate final
+{
+    std::uint64_t size;
+    std::uint64_t error_bound; // The encoded size is expected (about 95%) within size +/- error_bound.
+};
+
+// Purpose: estimates the encoded size of the complete image by encoding sampled bands of lines concurrently and
+// extrapolating their size. Small images are encoded completely, the estimate is then exact.
+// Note: the JPEG-LS headers are removed from the sampled bands before extrapolating and counted once.
+export [[nodiscard]]
+size_estimate estimate_size(const encoding_parameters& parameters, std::span<const std::byte> source, uint32_t stride);
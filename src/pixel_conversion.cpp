@@ -0,0 +1,738 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#include <immintrin.h>
+#define PIXEL_CONVERSION_X86
+#endif
+
+module pixel_conversion;
+
+import std;
+import "macros.hpp";
+
+using std::int32_t;
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+
+namespace {
+
+void copy_swap_red_blue_scalar(const std::byte* source, std::byte* destination, const size_t pixel_count,
+                               const size_t component_count) noexcept
+{
+    for (size_t i{}; i != pixel_count * component_count; i += component_count)
+    {
+        const std::byte blue{source[i]};
+        destination[i] = source[i + 2];
+        destination[i + 1] = source[i + 1];
+        destination[i + 2] = blue;
+        if (component_count == 4)
+        {
+            destination[i + 3] = source[i + 3];
+        }
+    }
+}
+
+#ifdef PIXEL_CONVERSION_X86
+
+enum class instruction_set
+{
+    none,
+    ssse3,
+    avx2
+};
+
+[[nodiscard]]
+instruction_set detect_instruction_set() noexcept
+{
+    std::array<int, 4> registers{};
+    __cpuid(registers.data(), 0);
+    const int maximum_leaf{registers[0]};
+
+    __cpuid(registers.data(), 1);
+    const bool ssse3{(registers[2] & (1 << 9)) != 0};
+    const bool os_saves_ymm{(registers[2] & (1 << 27)) != 0 && (registers[2] & (1 << 28)) != 0 && // OSXSAVE + AVX
+                            (_xgetbv(0) & 0x6) == 0x6};
+
+    if (os_saves_ymm && maximum_leaf >= 7)
+    {
+        __cpuidex(registers.data(), 7, 0);
+        if ((registers[1] & (1 << 5)) != 0)
+            return instruction_set::avx2;
+    }
+
+    return ssse3 ? instruction_set::ssse3 : instruction_set::none;
+}
+
+[[nodiscard]]
+instruction_set supported_instruction_set() noexcept
+{
+    static const instruction_set supported{detect_instruction_set()};
+    return supported;
+}
+
+// Returns the number of processed pixels, the remaining pixels are converted by the scalar code.
+// Note: 16 bytes are loaded for 5 pixels (15 bytes), the last byte is stored unmodified and rewritten by the next
+// iteration.
+[[nodiscard]]
+size_t copy_swap_red_blue_24_ssse3(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    const __m128i mask{_mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15)};
+
+    size_t i{};
+    for (; i + 6 <= pixel_count; i += 5)
+    {
+        const __m128i pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 3)))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (i * 3)), _mm_shuffle_epi8(pixels, mask));
+    }
+
+    return i;
+}
+
+[[nodiscard]]
+size_t copy_swap_red_blue_32_ssse3(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    const __m128i mask{_mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)};
+
+    size_t i{};
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        const __m128i pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 4)))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (i * 4)), _mm_shuffle_epi8(pixels, mask));
+    }
+
+    return i;
+}
+
+// AVX2 shuffles don't cross 128 bit lanes: every lane holds 4 pixels (12 bytes), the lanes are loaded and stored 12
+// bytes apart (the store of the second lane overwrites the 4 unmodified bytes of the first lane).
+[[nodiscard]]
+size_t copy_swap_red_blue_24_avx2(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    const __m256i mask{_mm256_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15, //
+                                        2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15)};
+
+    size_t i{};
+    for (; i + 10 <= pixel_count; i += 8)
+    {
+        const __m128i low{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 3)))};
+        const __m128i high{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 3) + 12))};
+        const __m256i pixels{_mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1), mask)};
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (i * 3)), _mm256_castsi256_si128(pixels));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (i * 3) + 12), _mm256_extracti128_si256(pixels, 1));
+    }
+
+    return i;
+}
+
+[[nodiscard]]
+size_t copy_swap_red_blue_32_avx2(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    const __m256i mask{_mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, //
+                                        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15)};
+
+    size_t i{};
+    for (; i + 8 <= pixel_count; i += 8)
+    {
+        const __m256i pixels{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + (i * 4)))};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + (i * 4)), _mm256_shuffle_epi8(pixels, mask));
+    }
+
+    return i;
+}
+
+// Returns the number of processed pixels.
+[[nodiscard]]
+size_t expand_gray_alpha_ssse3(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    const __m128i low_mask{_mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7)};
+    const __m128i high_mask{_mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15)};
+
+    size_t i{};
+    for (; i + 8 <= pixel_count; i += 8)
+    {
+        const __m128i pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 2)))};
+        auto* rgba{reinterpret_cast<__m128i*>(destination + (i * 4))};
+        _mm_storeu_si128(rgba, _mm_shuffle_epi8(pixels, low_mask));
+        _mm_storeu_si128(rgba + 1, _mm_shuffle_epi8(pixels, high_mask));
+    }
+
+    return i;
+}
+
+// The 8 source pixels are broadcast to both 128 bit lanes, every lane expands 4 of them.
+[[nodiscard]]
+size_t expand_gray_alpha_avx2(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    const __m256i mask{_mm256_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7, //
+                                        8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15)};
+
+    size_t i{};
+    for (; i + 8 <= pixel_count; i += 8)
+    {
+        const __m128i pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 2)))};
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + (i * 4)),
+                            _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(pixels), mask));
+    }
+
+    return i;
+}
+
+// Returns the number of processed pixels.
+// Note: 8 pixels (32 bytes) are loaded before the 16 bytes are stored, which allows in place conversion.
+[[nodiscard]]
+size_t extract_gray_alpha_ssse3(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    const __m128i mask{_mm_setr_epi8(0, 3, 4, 7, 8, 11, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1)};
+
+    size_t i{};
+    for (; i + 8 <= pixel_count; i += 8)
+    {
+        const __m128i low{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 4)))};
+        const __m128i high{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 4) + 16))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (i * 2)),
+                         _mm_unpacklo_epi64(_mm_shuffle_epi8(low, mask), _mm_shuffle_epi8(high, mask)));
+    }
+
+    return i;
+}
+
+// SSE2 is part of the baseline of all supported x86 processors.
+// The 16 bit shuffles reorder the words of both pixels in the register (words 0 and 2 are swapped).
+[[nodiscard]]
+size_t copy_swap_red_blue_64_sse2(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    size_t i{};
+    for (; i + 2 <= pixel_count; i += 2)
+    {
+        const __m128i pixels{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 8)))};
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (i * 8)),
+                         _mm_shufflehi_epi16(_mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2)));
+    }
+
+    return i;
+}
+
+[[nodiscard]]
+size_t copy_swap_red_blue_64_avx2(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    size_t i{};
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        const __m256i pixels{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + (i * 8)))};
+        _mm256_storeu_si256(
+            reinterpret_cast<__m256i*>(destination + (i * 8)),
+            _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2)));
+    }
+
+    return i;
+}
+
+// Every source byte is replicated to 8 bytes, each byte then tests 1 bit (most significant bit in the first byte).
+[[nodiscard]]
+size_t expand_bits_sse2(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    const __m128i bit_mask{_mm_set1_epi64x(0x0102040810204080)};
+    const __m128i one{_mm_set1_epi8(1)};
+    const auto expand{[&bit_mask, &one](const __m128i replicated) {
+        return _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(replicated, bit_mask), bit_mask), one);
+    }};
+
+    size_t i{};
+    for (; i + 16 <= byte_count; i += 16)
+    {
+        const __m128i packed{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i))};
+        const std::array pairs{_mm_unpacklo_epi8(packed, packed), _mm_unpackhi_epi8(packed, packed)};
+
+        auto* samples{reinterpret_cast<__m128i*>(destination + (i * 8))};
+        for (const __m128i pair : pairs)
+        {
+            const __m128i low{_mm_unpacklo_epi16(pair, pair)};
+            const __m128i high{_mm_unpackhi_epi16(pair, pair)};
+            _mm_storeu_si128(samples++, expand(_mm_unpacklo_epi32(low, low)));
+            _mm_storeu_si128(samples++, expand(_mm_unpackhi_epi32(low, low)));
+            _mm_storeu_si128(samples++, expand(_mm_unpacklo_epi32(high, high)));
+            _mm_storeu_si128(samples++, expand(_mm_unpackhi_epi32(high, high)));
+        }
+    }
+
+    return i;
+}
+
+// The samples are moved to the sign bit of every byte and reversed per 8 bytes: the mask of the sign bits then has the
+// first sample of every 8 in its most significant bit.
+[[nodiscard]]
+size_t pack_bits_sse2(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    size_t i{};
+    for (; i + 2 <= byte_count; i += 2)
+    {
+        __m128i samples{_mm_slli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 8))), 7)};
+        samples = _mm_shufflehi_epi16(_mm_shufflelo_epi16(samples, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+        samples = _mm_or_si128(_mm_slli_epi16(samples, 8), _mm_srli_epi16(samples, 8));
+
+        const auto bits{static_cast<uint32_t>(_mm_movemask_epi8(samples))};
+        destination[i] = static_cast<std::byte>(bits);
+        destination[i + 1] = static_cast<std::byte>(bits >> 8);
+    }
+
+    return i;
+}
+
+[[nodiscard]]
+size_t expand_crumbs_sse2(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    const __m128i mask{_mm_set1_epi8(0x03)};
+
+    size_t i{};
+    for (; i + 16 <= byte_count; i += 16)
+    {
+        // Note: the 16 bit shifts move bits of the neighbour byte in, which are cleared by the mask.
+        const __m128i packed{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i))};
+        const __m128i first{_mm_and_si128(_mm_srli_epi16(packed, 6), mask)};
+        const __m128i second{_mm_and_si128(_mm_srli_epi16(packed, 4), mask)};
+        const __m128i third{_mm_and_si128(_mm_srli_epi16(packed, 2), mask)};
+        const __m128i fourth{_mm_and_si128(packed, mask)};
+
+        const __m128i first_second_low{_mm_unpacklo_epi8(first, second)};
+        const __m128i first_second_high{_mm_unpackhi_epi8(first, second)};
+        const __m128i third_fourth_low{_mm_unpacklo_epi8(third, fourth)};
+        const __m128i third_fourth_high{_mm_unpackhi_epi8(third, fourth)};
+
+        auto* samples{reinterpret_cast<__m128i*>(destination + (i * 4))};
+        _mm_storeu_si128(samples, _mm_unpacklo_epi16(first_second_low, third_fourth_low));
+        _mm_storeu_si128(samples + 1, _mm_unpackhi_epi16(first_second_low, third_fourth_low));
+        _mm_storeu_si128(samples + 2, _mm_unpacklo_epi16(first_second_high, third_fourth_high));
+        _mm_storeu_si128(samples + 3, _mm_unpackhi_epi16(first_second_high, third_fourth_high));
+    }
+
+    return i;
+}
+
+[[nodiscard]]
+size_t expand_nibbles_sse2(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    const __m128i mask{_mm_set1_epi8(0x0F)};
+
+    size_t i{};
+    for (; i + 16 <= byte_count; i += 16)
+    {
+        const __m128i packed{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i))};
+        const __m128i high{_mm_and_si128(_mm_srli_epi16(packed, 4), mask)};
+        const __m128i low{_mm_and_si128(packed, mask)};
+
+        auto* samples{reinterpret_cast<__m128i*>(destination + (i * 2))};
+        _mm_storeu_si128(samples, _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128(samples + 1, _mm_unpackhi_epi8(high, low));
+    }
+
+    return i;
+}
+
+// The AVX2 unpack instructions interleave within 128 bit lanes: the lanes are reordered before the stores.
+[[nodiscard]]
+size_t expand_nibbles_avx2(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    const __m256i mask{_mm256_set1_epi8(0x0F)};
+
+    size_t i{};
+    for (; i + 32 <= byte_count; i += 32)
+    {
+        const __m256i packed{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i))};
+        const __m256i high{_mm256_and_si256(_mm256_srli_epi16(packed, 4), mask)};
+        const __m256i low{_mm256_and_si256(packed, mask)};
+        const __m256i interleaved_low{_mm256_unpacklo_epi8(high, low)};
+        const __m256i interleaved_high{_mm256_unpackhi_epi8(high, low)};
+
+        auto* samples{reinterpret_cast<__m256i*>(destination + (i * 2))};
+        _mm256_storeu_si256(samples, _mm256_permute2x128_si256(interleaved_low, interleaved_high, 0x20));
+        _mm256_storeu_si256(samples + 1, _mm256_permute2x128_si256(interleaved_low, interleaved_high, 0x31));
+    }
+
+    return i;
+}
+
+[[nodiscard]]
+uint16_t bitwise_or(__m128i samples) noexcept
+{
+    samples = _mm_or_si128(samples, _mm_srli_si128(samples, 8));
+    samples = _mm_or_si128(samples, _mm_srli_si128(samples, 4));
+    samples = _mm_or_si128(samples, _mm_srli_si128(samples, 2));
+    return static_cast<uint16_t>(_mm_cvtsi128_si32(samples));
+}
+
+// Returns the number of processed samples, the bitwise OR of the processed source samples is stored in bits.
+[[nodiscard]]
+size_t copy_shift_right_sse2(const std::byte* source, std::byte* destination, const size_t sample_count,
+                             const uint32_t shift, uint16_t& bits) noexcept
+{
+    const __m128i count{_mm_cvtsi32_si128(static_cast<int>(shift))};
+    __m128i accumulated{_mm_setzero_si128()};
+
+    size_t i{};
+    for (; i + 8 <= sample_count; i += 8)
+    {
+        const __m128i samples{_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + (i * 2)))};
+        accumulated = _mm_or_si128(accumulated, samples);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (i * 2)), _mm_srl_epi16(samples, count));
+    }
+
+    bits = bitwise_or(accumulated);
+    return i;
+}
+
+[[nodiscard]]
+size_t copy_shift_right_avx2(const std::byte* source, std::byte* destination, const size_t sample_count,
+                             const uint32_t shift, uint16_t& bits) noexcept
+{
+    const __m128i count{_mm_cvtsi32_si128(static_cast<int>(shift))};
+    __m256i accumulated{_mm256_setzero_si256()};
+
+    size_t i{};
+    for (; i + 16 <= sample_count; i += 16)
+    {
+        const __m256i samples{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + (i * 2)))};
+        accumulated = _mm256_or_si256(accumulated, samples);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + (i * 2)), _mm256_srl_epi16(samples, count));
+    }
+
+    bits = bitwise_or(_mm_or_si128(_mm256_castsi256_si128(accumulated), _mm256_extracti128_si256(accumulated, 1)));
+    return i;
+}
+
+// Returns the number of processed samples.
+[[nodiscard]]
+size_t shift_left_sse2(std::byte* samples, const size_t sample_count, const uint32_t shift) noexcept
+{
+    const __m128i count{_mm_cvtsi32_si128(static_cast<int>(shift))};
+
+    size_t i{};
+    for (; i + 8 <= sample_count; i += 8)
+    {
+        auto* destination{reinterpret_cast<__m128i*>(samples + (i * 2))};
+        _mm_storeu_si128(destination, _mm_sll_epi16(_mm_loadu_si128(destination), count));
+    }
+
+    return i;
+}
+
+[[nodiscard]]
+size_t shift_left_avx2(std::byte* samples, const size_t sample_count, const uint32_t shift) noexcept
+{
+    const __m128i count{_mm_cvtsi32_si128(static_cast<int>(shift))};
+
+    size_t i{};
+    for (; i + 16 <= sample_count; i += 16)
+    {
+        auto* destination{reinterpret_cast<__m256i*>(samples + (i * 2))};
+        _mm256_storeu_si256(destination, _mm256_sll_epi16(_mm256_loadu_si256(destination), count));
+    }
+
+    return i;
+}
+
+[[nodiscard]]
+bool all_zero(const __m128i bytes) noexcept
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())) == 0xFFFF;
+}
+
+// Returns the number of processed pixels.
+// Note: 17 bytes are loaded for 5 pixels (15 bytes), the bytes of the next pixels are masked.
+[[nodiscard]]
+size_t find_redundant_components_24_sse2(const std::byte* pixels, const size_t pixel_count,
+                                         redundant_components& redundant) noexcept
+{
+    // Selects R ^ G and G ^ B of every pixel.
+    const __m128i color_mask{_mm_setr_epi8(-1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, -1, -1, 0, 0)};
+    __m128i color_difference{_mm_setzero_si128()};
+
+    size_t i{};
+    for (; i + 6 <= pixel_count; i += 5)
+    {
+        const __m128i current{_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + (i * 3)))};
+        const __m128i next{_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + (i * 3) + 1))};
+        color_difference = _mm_or_si128(color_difference, _mm_and_si128(_mm_xor_si128(current, next), color_mask));
+    }
+
+    redundant.neutral = redundant.neutral && all_zero(color_difference);
+    return i;
+}
+
+[[nodiscard]]
+size_t find_redundant_components_32_sse2(const std::byte* pixels, const size_t pixel_count,
+                                         redundant_components& redundant) noexcept
+{
+    const __m128i color_mask{_mm_set1_epi32(0x0000FFFF)}; // R ^ G and G ^ B.
+    const __m128i alpha_mask{_mm_set1_epi32(static_cast<int>(0xFF000000))};
+    const __m128i alpha{_mm_set1_epi32(static_cast<int>(std::to_integer<uint32_t>(redundant.alpha) << 24))};
+    __m128i color_difference{_mm_setzero_si128()};
+    __m128i alpha_difference{_mm_setzero_si128()};
+
+    size_t i{};
+    for (; i + 4 <= pixel_count; i += 4)
+    {
+        const __m128i rgba{_mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + (i * 4)))};
+        color_difference = _mm_or_si128(color_difference, _mm_xor_si128(rgba, _mm_srli_epi32(rgba, 8)));
+        alpha_difference = _mm_or_si128(alpha_difference, _mm_xor_si128(rgba, alpha));
+    }
+
+    redundant.neutral = redundant.neutral && all_zero(_mm_and_si128(color_difference, color_mask));
+    redundant.constant_alpha = redundant.constant_alpha && all_zero(_mm_and_si128(alpha_difference, alpha_mask));
+    return i;
+}
+
+#endif
+
+} // namespace
+
+void copy_swap_red_blue(const std::byte* source, std::byte* destination, const size_t pixel_count,
+                        const int32_t component_count) noexcept
+{
+    ASSERT(component_count == 3 || component_count == 4);
+
+    size_t converted_count{};
+
+#ifdef PIXEL_CONVERSION_X86
+    switch (supported_instruction_set())
+    {
+    case instruction_set::avx2:
+        converted_count = component_count == 3 ? copy_swap_red_blue_24_avx2(source, destination, pixel_count)
+                                               : copy_swap_red_blue_32_avx2(source, destination, pixel_count);
+        break;
+
+    case instruction_set::ssse3:
+        converted_count = component_count == 3 ? copy_swap_red_blue_24_ssse3(source, destination, pixel_count)
+                                               : copy_swap_red_blue_32_ssse3(source, destination, pixel_count);
+        break;
+
+    case instruction_set::none:
+        break;
+    }
+#endif
+
+    const auto offset{converted_count * static_cast<size_t>(component_count)};
+    copy_swap_red_blue_scalar(source + offset, destination + offset, pixel_count - converted_count,
+                              static_cast<size_t>(component_count));
+}
+
+void copy_swap_red_blue_16(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    if (supported_instruction_set() == instruction_set::avx2)
+    {
+        i = copy_swap_red_blue_64_avx2(source, destination, pixel_count);
+    }
+    i += copy_swap_red_blue_64_sse2(source + (i * 8), destination + (i * 8), pixel_count - i);
+#endif
+
+    const auto* source_samples{reinterpret_cast<const uint16_t*>(source)};
+    auto* destination_samples{reinterpret_cast<uint16_t*>(destination)};
+    for (; i != pixel_count; ++i)
+    {
+        const uint16_t blue{source_samples[(i * 4)]};
+        destination_samples[(i * 4)] = source_samples[(i * 4) + 2];
+        destination_samples[(i * 4) + 1] = source_samples[(i * 4) + 1];
+        destination_samples[(i * 4) + 2] = blue;
+        destination_samples[(i * 4) + 3] = source_samples[(i * 4) + 3];
+    }
+}
+
+void expand_bits(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    i = expand_bits_sse2(source, destination, byte_count);
+#endif
+
+    for (; i != byte_count; ++i)
+    {
+        for (size_t bit{}; bit != 8; ++bit)
+        {
+            destination[(i * 8) + bit] = (source[i] >> (7 - bit)) & std::byte{0x01};
+        }
+    }
+}
+
+void pack_bits(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    i = pack_bits_sse2(source, destination, byte_count);
+#endif
+
+    for (; i != byte_count; ++i)
+    {
+        std::byte value{};
+        for (size_t bit{}; bit != 8; ++bit)
+        {
+            value |= source[(i * 8) + bit] << (7 - bit);
+        }
+        destination[i] = value;
+    }
+}
+
+void expand_crumbs(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    i = expand_crumbs_sse2(source, destination, byte_count);
+#endif
+
+    for (; i != byte_count; ++i)
+    {
+        destination[(i * 4)] = source[i] >> 6;
+        destination[(i * 4) + 1] = (source[i] >> 4) & std::byte{0x03};
+        destination[(i * 4) + 2] = (source[i] >> 2) & std::byte{0x03};
+        destination[(i * 4) + 3] = source[i] & std::byte{0x03};
+    }
+}
+
+void expand_nibbles(const std::byte* source, std::byte* destination, const size_t byte_count) noexcept
+{
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    if (supported_instruction_set() == instruction_set::avx2)
+    {
+        i = expand_nibbles_avx2(source, destination, byte_count);
+    }
+    i += expand_nibbles_sse2(source + i, destination + (i * 2), byte_count - i);
+#endif
+
+    for (; i != byte_count; ++i)
+    {
+        destination[(i * 2)] = source[i] >> 4;
+        destination[(i * 2) + 1] = source[i] & std::byte{0x0F};
+    }
+}
+
+uint16_t copy_shift_right(const std::byte* source, std::byte* destination, const size_t sample_count,
+                          const uint32_t shift) noexcept
+{
+    size_t i{};
+    uint16_t bits{};
+
+#ifdef PIXEL_CONVERSION_X86
+    if (supported_instruction_set() == instruction_set::avx2)
+    {
+        i = copy_shift_right_avx2(source, destination, sample_count, shift, bits);
+    }
+    uint16_t sse2_bits;
+    i += copy_shift_right_sse2(source + (i * 2), destination + (i * 2), sample_count - i, shift, sse2_bits);
+    bits |= sse2_bits;
+#endif
+
+    const auto* source_samples{reinterpret_cast<const uint16_t*>(source)};
+    auto* destination_samples{reinterpret_cast<uint16_t*>(destination)};
+    for (; i != sample_count; ++i)
+    {
+        const uint16_t sample{source_samples[i]};
+        bits |= sample;
+        destination_samples[i] = static_cast<uint16_t>(sample >> shift);
+    }
+
+    return bits;
+}
+
+void shift_left(std::byte* samples, const size_t sample_count, const uint32_t shift) noexcept
+{
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    if (supported_instruction_set() == instruction_set::avx2)
+    {
+        i = shift_left_avx2(samples, sample_count, shift);
+    }
+    i += shift_left_sse2(samples + (i * 2), sample_count - i, shift);
+#endif
+
+    auto* values{reinterpret_cast<uint16_t*>(samples)};
+    for (; i != sample_count; ++i)
+    {
+        values[i] = static_cast<uint16_t>(values[i] << shift);
+    }
+}
+
+void expand_gray_alpha(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    switch (supported_instruction_set())
+    {
+    case instruction_set::avx2:
+        i = expand_gray_alpha_avx2(source, destination, pixel_count);
+        break;
+
+    case instruction_set::ssse3:
+        i = expand_gray_alpha_ssse3(source, destination, pixel_count);
+        break;
+
+    case instruction_set::none:
+        break;
+    }
+#endif
+
+    for (; i != pixel_count; ++i)
+    {
+        const std::byte gray{source[(i * 2)]};
+        destination[(i * 4)] = gray;
+        destination[(i * 4) + 1] = gray;
+        destination[(i * 4) + 2] = gray;
+        destination[(i * 4) + 3] = source[(i * 2) + 1];
+    }
+}
+
+void extract_gray_alpha(const std::byte* source, std::byte* destination, const size_t pixel_count) noexcept
+{
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    if (supported_instruction_set() != instruction_set::none)
+    {
+        i = extract_gray_alpha_ssse3(source, destination, pixel_count);
+    }
+#endif
+
+    for (; i != pixel_count; ++i)
+    {
+        destination[(i * 2)] = source[(i * 4)];
+        destination[(i * 2) + 1] = source[(i * 4) + 3];
+    }
+}
+
+void find_redundant_components(const std::byte* pixels, const size_t pixel_count, const int32_t component_count,
+                               redundant_components& redundant) noexcept
+{
+    ASSERT(component_count == 3 || component_count == 4);
+
+    size_t i{};
+
+#ifdef PIXEL_CONVERSION_X86
+    i = component_count == 3 ? find_redundant_components_24_sse2(pixels, pixel_count, redundant)
+                             : find_redundant_components_32_sse2(pixels, pixel_count, redundant);
+#endif
+
+    for (; i != pixel_count && redundant.any(); ++i)
+    {
+        const std::byte* pixel{pixels + (i * static_cast<size_t>(component_count))};
+        redundant.neutral = redundant.neutral && pixel[0] == pixel[1] && pixel[1] == pixel[2];
+        if (component_count == 4)
+        {
+            redundant.constant_alpha = redundant.constant_alpha && pixel[3] == redundant.alpha;
+        }
+    }
+}
@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module pixel_conversion;
+
+import std;
+
+// Note: the conversions use SSE2/SSSE3 or AVX2 kernels when the processor supports them.
+
+// Purpose: copies pixel_count 8 bit pixels with 3 (BGR) or 4 (BGRA) components and swaps the first and third
+// component of every pixel (BGR => RGB). The source and destination may be the same row (in place conversion),
+// otherwise they must not overlap.
+export void copy_swap_red_blue(const std::byte* source, std::byte* destination, std::size_t pixel_count,
+                               std::int32_t component_count) noexcept;
+
+// Purpose: copies pixel_count 16 bit pixels with 4 components (BGRA) and swaps the first and third component of every
+// pixel (BGRA => RGBA). The source and destination may be the same row (in place conversion), otherwise they must not
+// overlap.
+export void copy_swap_red_blue_16(const std::byte* source, std::byte* destination, std::size_t pixel_count) noexcept;
+
+// Purpose: expands byte_count bytes with 8 packed 1 bit samples (most significant bit first) to 1 sample per byte.
+export void expand_bits(const std::byte* source, std::byte* destination, std::size_t byte_count) noexcept;
+
+// Purpose: packs byte_count * 8 samples with the value 0 or 1 to 8 samples per byte (most significant bit first).
+export void pack_bits(const std::byte* source, std::byte* destination, std::size_t byte_count) noexcept;
+
+// Purpose: expands byte_count bytes with 4 packed 2 bit samples (most significant bits first) to 1 sample per byte.
+export void expand_crumbs(const std::byte* source, std::byte* destination, std::size_t byte_count) noexcept;
+
+// Purpose: expands byte_count bytes with 2 packed 4 bit samples (most significant bits first) to 1 sample per byte.
+export void expand_nibbles(const std::byte* source, std::byte* destination, std::size_t byte_count) noexcept;
+
+// Purpose: copies sample_count 16 bit samples shifted right by shift bits (left-aligned samples => right-aligned) and
+// returns the bitwise OR of the source samples, which gives the significant bits of the samples. The source and
+// destination may be the same row (in place conversion), otherwise they must not overlap.
+export std::uint16_t copy_shift_right(const std::byte* source, std::byte* destination, std::size_t sample_count,
+                                      std::uint32_t shift) noexcept;
+
+// Purpose: shifts sample_count 16 bit samples left by shift bits (right-aligned samples => left-aligned), in place.
+export void shift_left(std::byte* samples, std::size_t sample_count, std::uint32_t shift) noexcept;
+
+// Purpose: expands pixel_count 8 bit gray + alpha pixels to RGBA pixels (the gray sample is replicated to R, G and B).
+export void expand_gray_alpha(const std::byte* source, std::byte* destination, std::size_t pixel_count) noexcept;
+
+// Purpose: copies the gray (R) and alpha components of pixel_count 8 bit neutral RGBA pixels. The destination may start
+// at (or before) the source (in place conversion).
+export void extract_gray_alpha(const std::byte* source, std::byte* destination, std::size_t pixel_count) noexcept;
+
+// Components of 8 bit RGB(A) pixels that have the same value in every pixel and can be removed before encoding.
+export struct redundant_components final
+{
+    bool neutral{true};        // R == G == B.
+    bool constant_alpha{true}; // A == alpha (4 components).
+    std::byte alpha;
+
+    [[nodiscard]]
+    bool any() const noexcept
+    {
+        return neutral || constant_alpha;
+    }
+};
+
+// Purpose: updates redundant with pixel_count 8 bit pixels with 3 (RGB) or 4 (RGBA) components.
+export void find_redundant_components(const std::byte* pixels, std::size_t pixel_count, std::int32_t component_count,
+                                      redundant_components& redundant) noexcept;
@@ -12,11 +12,13 @@ import winrt_base;
 import charls;
 import <win.hpp>;
 
+import header_cache;
 import hresults;
 import util;
 import class_factory;
 import property_variant;
 import storage_buffer;
+import stream_memory;
 import "macros.hpp";
 
 using std::array;
@@ -57,19 +59,9 @@ struct property_store : winrt::implements<property_store, IInitializeWithStream,
         if (initialized_)
             return error_already_initialized;
 
-        ULARGE_INTEGER size;
-        check_hresult(IStream_Size(stream, &size));
-
-        const storage_buffer buffer{size.LowPart};
-        check_hresult(IStream_Read(stream, buffer.data(), static_cast<ULONG>(buffer.size())));
-
-        charls::jpegls_decoder decoder{buffer, false};
-        std::error_code error;
-        decoder.read_header(error);
-        if (error)
-            winrt::throw_hresult(wincodec::error_bad_header);
-
-        const auto& [width, height, bits_per_sample, component_count]{decoder.frame_info()};
+        check_in_pointer(stream);
+        const auto info{header_cache::find(*stream).or_else([stream] { return read_header_info(*stream); })};
+        const auto& [width, height, bits_per_sample, component_count]{info->frame_info};
 
         property_values_[0] = property_variant{width};
         property_values_[1] = property_variant{height};
@@ -162,6 +154,38 @@ struct property_store : winrt::implements<property_store, IInitializeWithStream,
     }
 
 private:
+    [[nodiscard]]
+    static std::optional<header_info> read_header_info(IStream& stream)
+    {
+        std::optional<storage_buffer> buffer;
+        const auto memory{stream_memory::from(stream)};
+        if (!memory)
+        {
+            ULARGE_INTEGER size;
+            check_hresult(IStream_Size(&stream, &size));
+
+            buffer.emplace(size.LowPart);
+            check_hresult(IStream_Read(&stream, buffer->data(), static_cast<ULONG>(buffer->size())));
+        }
+        const span<const std::byte> encoded_data{memory ? memory->bytes()
+                                                        : span<const std::byte>{buffer->data(), buffer->size()}};
+
+        charls::jpegls_decoder decoder{encoded_data, false};
+        std::error_code error;
+        decoder.read_spiff_header(error);
+        if (!error)
+        {
+            decoder.read_header(error);
+        }
+
+        if (error)
+            winrt::throw_hresult(wincodec::error_bad_header);
+
+        auto info{header_info::from(decoder)};
+        header_cache::insert(stream, encoded_data, info);
+        return info;
+    }
+
     void check_state() const
     {
         if (!initialized_)
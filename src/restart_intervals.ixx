@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module restart_intervals;
+
+import std;
+import charls;
+
+import jpegls_markers;
+import storage_buffer;
+import util;
+import "macros.hpp";
+
+using std::size_t;
+using std::span;
+using std::uint32_t;
+
+// Index of the restart intervals in the scan of an encoded image. JPEG-LS resets its coding state at a restart marker,
+// which makes the lines of consecutive intervals decodable as an independent image (the reverse of the stitching done
+// by the stripe encoder).
+export class restart_intervals final
+{
+public:
+    // Returns no value when the image has no restart intervals or can't be split (multiple scans, unexpected markers).
+    [[nodiscard]]
+    static std::optional<restart_intervals> from(const span<const std::byte> encoded, const charls::frame_info& frame_info,
+                                                 const charls::interleave_mode interleave_mode)
+    {
+        constexpr uint32_t maximum_height{std::numeric_limits<std::uint16_t>::max()}; // Height field of SOF55.
+        if ((frame_info.component_count != 1 && interleave_mode == charls::interleave_mode::none) ||
+            frame_info.height > maximum_height)
+            return {};
+
+        const auto scan{find_first_scan(encoded)};
+        if (!scan || scan->restart_interval == 0 || !scan->start_of_frame)
+            return {};
+
+        // In the entropy coded data a 0xFF byte is followed by a byte with the high bit cleared (bit stuffing): a
+        // byte with the high bit set after 0xFF is a marker.
+        std::vector<size_t> starts{scan->entropy_coded_data};
+        std::vector<size_t> ends;
+        for (size_t position{scan->entropy_coded_data};;)
+        {
+            position = static_cast<size_t>(std::find(encoded.begin() + position, encoded.end(), marker_start) -
+                                           encoded.begin());
+            if (position + 1 >= encoded.size())
+                return {};
+
+            const std::byte marker{encoded[position + 1]};
+            if ((marker & 0x80_byte) == 0_byte)
+            {
+                position += 2;
+                continue;
+            }
+
+            ends.push_back(position);
+            if ((marker & 0xF8_byte) != restart_marker0)
+                break;
+
+            if (marker != (restart_marker0 | static_cast<std::byte>((ends.size() - 1) % restart_marker_range)))
+                return {};
+
+            position += 2;
+            starts.push_back(position);
+        }
+
+        if (starts.size() != (frame_info.height + (scan->restart_interval - 1)) / scan->restart_interval)
+            return {};
+
+        return restart_intervals{encoded, *scan, frame_info.height, std::move(starts), std::move(ends)};
+    }
+
+    [[nodiscard]]
+    uint32_t interval_height() const noexcept
+    {
+        return scan_.restart_interval;
+    }
+
+    [[nodiscard]]
+    uint32_t count() const noexcept
+    {
+        return static_cast<uint32_t>(starts_.size());
+    }
+
+    // Returns an encoded image with the lines of interval_count intervals, starting at first_interval.
+    [[nodiscard]]
+    storage_buffer extract(const uint32_t first_interval, const uint32_t interval_count) const
+    {
+        ASSERT(interval_count > 0 && first_interval + interval_count <= count());
+
+        size_t size{scan_.entropy_coded_data + end_of_image_bytes.size()};
+        for (uint32_t i{}; i != interval_count; ++i)
+        {
+            size += (i == 0 ? 0 : 2) + ends_[first_interval + i] - starts_[first_interval + i];
+        }
+
+        // The headers are copied (with an updated height), the restart markers are renumbered from RST0.
+        storage_buffer image{size};
+        std::byte* position{std::copy_n(encoded_.data(), scan_.entropy_coded_data, image.data())};
+        set_frame_height({image.data(), size}, scan_,
+                         std::min(interval_count * interval_height(), height_ - (first_interval * interval_height())));
+
+        for (uint32_t i{}; i != interval_count; ++i)
+        {
+            if (i != 0)
+            {
+                *position++ = marker_start;
+                *position++ = restart_marker0 | static_cast<std::byte>((i - 1) % restart_marker_range);
+            }
+
+            const size_t interval{first_interval + i};
+            position = std::copy(encoded_.data() + starts_[interval], encoded_.data() + ends_[interval], position);
+        }
+
+        std::ranges::copy(end_of_image_bytes, position);
+        return image;
+    }
+
+private:
+    restart_intervals(const span<const std::byte> encoded, const scan_position& scan, const uint32_t height,
+                      std::vector<size_t> starts, std::vector<size_t> ends) noexcept :
+        encoded_{encoded}, scan_{scan}, height_{height}, starts_{std::move(starts)}, ends_{std::move(ends)}
+    {
+    }
+
+    span<const std::byte> encoded_;
+    scan_position scan_;
+    uint32_t height_;
+    std::vector<size_t> starts_; // Position of the entropy coded data of every interval.
+    std::vector<size_t> ends_;   // Position of the marker that ends every interval.
+};
@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module right_aligned_samples;
+
+import std;
+
+// Marks a 9 to 15 bit image that is encoded from right-aligned 16 bit samples (unused high bits). Stored in an
+// application data segment, the decoder then returns the samples unshifted instead of in the most significant bits.
+export struct right_aligned_samples final
+{
+    static constexpr std::int32_t application_data_id{9}; // APP9
+
+    [[nodiscard]]
+    static std::span<const std::byte> to_application_data() noexcept
+    {
+        return identifier;
+    }
+
+    // Other applications also use APPn: only a segment with the identifier marks right-aligned samples.
+    [[nodiscard]]
+    static bool is_application_data(const std::span<const std::byte> data) noexcept
+    {
+        return std::ranges::equal(data, identifier);
+    }
+
+private:
+    static constexpr std::array identifier{std::byte{'j'}, std::byte{'p'}, std::byte{'e'}, std::byte{'g'},
+                                           std::byte{'l'}, std::byte{'s'}, std::byte{'-'}, std::byte{'w'},
+                                           std::byte{'i'}, std::byte{'c'}, std::byte{'-'}, std::byte{'r'},
+                                           std::byte{'a'}, std::byte{0}};
+};
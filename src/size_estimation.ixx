@@ -0,0 +1,21 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+export module size_estimation;
+
+import <win.hpp>;
+
+// Interface implemented by the frame encoder to estimate the encoded size of a frame without encoding it completely.
+// The estimate is available after all pixels are written (WritePixels or WriteSource) and before Commit, it requires
+// WICBitmapEncoderCacheInMemory (with WICBitmapEncoderNoCache the stripes are already written).
+// The estimate uses the encoder options of the frame.
+export struct __declspec(uuid("9a4e2c71-5b3d-4f08-b6e1-2c7d8f3a5e94")) __declspec(novtable) IJpegLsSizeEstimation
+    : IUnknown
+{
+    // The encoded size is expected (with about 95% confidence) within estimated_size +/- error_bound bytes.
+    virtual HRESULT __stdcall EstimateSize(_Out_ ULONGLONG* estimated_size, _Out_ ULONGLONG* error_bound) noexcept = 0;
+};
@@ -0,0 +1,145 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+export module stream_memory;
+
+import std;
+import winrt_base;
+import <win.hpp>;
+
+import memory_mapped_file;
+
+using std::uint64_t;
+
+// Optional interface that IStream implementations that keep their content in memory can implement.
+// It allows the decoder to read the encoded data directly from the memory of the stream.
+export struct __declspec(uuid("3f0c9b2e-7d4a-4c61-a8e5-5b1d2e6f9a07")) __declspec(novtable) IStreamMemoryAccess : IUnknown
+{
+    // The memory must remain valid and unmodified as long as the stream is alive.
+    virtual HRESULT __stdcall GetMemory(_Outptr_result_bytebuffer_(*size) const BYTE** memory,
+                                        _Out_ ULONGLONG* size) noexcept = 0;
+};
+
+// Purpose: provides read-only access to the content of a memory-backed or file-backed stream, from the current position
+// to the end.
+export class stream_memory final
+{
+public:
+    // Returns no value when the stream is not memory-backed, the caller should then read the content.
+    [[nodiscard]]
+    static std::optional<stream_memory> from(IStream& stream) noexcept
+    try
+    {
+        const auto position{get_position(stream)};
+
+        if (winrt::com_ptr<IStreamMemoryAccess> memory_access; SUCCEEDED(stream.QueryInterface(memory_access.put())))
+        {
+            const BYTE* memory;
+            ULONGLONG size;
+            if (FAILED(memory_access->GetMemory(&memory, &size)) || position > size)
+                return {};
+
+            return stream_memory{stream, nullptr, {reinterpret_cast<const std::byte*>(memory) + position, size - position}};
+        }
+
+        // Streams created by CreateStreamOnHGlobal. Note: the size of the HGLOBAL can be larger than the stream.
+        if (HGLOBAL global; SUCCEEDED(GetHGlobalFromStream(&stream, &global)))
+        {
+            ULARGE_INTEGER size;
+            winrt::check_hresult(IStream_Size(&stream, &size));
+            if (position > size.QuadPart || size.QuadPart > GlobalSize(global))
+                return {};
+
+            const auto* memory{static_cast<const std::byte*>(GlobalLock(global))};
+            if (!memory)
+                return {};
+
+            return stream_memory{stream, global, {memory + position, size.QuadPart - position}};
+        }
+
+        // Streams on a file (SHCreateStreamOnFileEx) that report the full path of the file: map the file.
+        STATSTG stat{};
+        if (FAILED(stream.Stat(&stat, STATFLAG_DEFAULT)))
+            return {};
+
+        const std::unique_ptr<wchar_t, decltype(&CoTaskMemFree)> name{stat.pwcsName, &CoTaskMemFree};
+        if (!name || stat.type != STGTY_STREAM || !std::filesystem::path{name.get()}.is_absolute())
+            return {};
+
+        auto mapped_file{memory_mapped_file::open(name.get())};
+        if (!mapped_file || mapped_file->bytes().size() != stat.cbSize.QuadPart || position > stat.cbSize.QuadPart)
+            return {};
+
+        const auto bytes{mapped_file->bytes().subspan(static_cast<size_t>(position))};
+        return stream_memory{stream, std::move(*mapped_file), bytes};
+    }
+    catch (...)
+    {
+        return {};
+    }
+
+    ~stream_memory()
+    {
+        if (global_)
+        {
+            GlobalUnlock(global_);
+        }
+    }
+
+    stream_memory(const stream_memory&) = delete;
+    stream_memory& operator=(const stream_memory&) = delete;
+
+    stream_memory(stream_memory&& other) noexcept :
+        stream_{std::move(other.stream_)},
+        global_{std::exchange(other.global_, nullptr)},
+        mapped_file_{std::move(other.mapped_file_)},
+        bytes_{other.bytes_}
+    {
+    }
+
+    stream_memory& operator=(stream_memory&&) = delete;
+
+    [[nodiscard]]
+    std::span<const std::byte> bytes() const noexcept
+    {
+        return bytes_;
+    }
+
+    // The HGLOBAL of a stream can be shared (other streams, the caller's handle): it can be modified or reallocated
+    // after the decoder is created. Only IStreamMemoryAccess guarantees that the memory remains valid and unmodified.
+    [[nodiscard]]
+    bool shared_global() const noexcept
+    {
+        return global_ != nullptr;
+    }
+
+private:
+    stream_memory(IStream& stream, HGLOBAL global, const std::span<const std::byte> bytes) noexcept :
+        global_{global}, bytes_{bytes}
+    {
+        stream_.copy_from(&stream); // Keeps the memory alive.
+    }
+
+    stream_memory(IStream& stream, memory_mapped_file mapped_file, const std::span<const std::byte> bytes) noexcept :
+        mapped_file_{std::move(mapped_file)}, bytes_{bytes}
+    {
+        stream_.copy_from(&stream);
+    }
+
+    [[nodiscard]]
+    static uint64_t get_position(IStream& stream)
+    {
+        ULARGE_INTEGER position;
+        winrt::check_hresult(stream.Seek({}, STREAM_SEEK_CUR, &position));
+        return position.QuadPart;
+    }
+
+    winrt::com_ptr<IStream> stream_;
+    HGLOBAL global_{};
+    std::optional<memory_mapped_file> mapped_file_;
+    std::span<const std::byte> bytes_;
+};
@@ -0,0 +1,431 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+module;
+
+#include "intellisense.hpp"
+
+module stripe_encoder;
+
+import std;
+import winrt_base;
+import charls;
+import <win.hpp>;
+
+import hresults;
+import jpegls_markers;
+import original_components;
+import right_aligned_samples;
+import storage_buffer;
+import util;
+import "macros.hpp";
+
+using charls::jpegls_encoder;
+using charls::spiff_color_space;
+using charls::spiff_resolution_units;
+using std::int32_t;
+using std::span;
+using std::uint16_t;
+using std::uint32_t;
+using winrt::throw_hresult;
+
+namespace {
+
+constexpr size_t restart_interval_segment_size{6};
+
+[[nodiscard]]
+spiff_color_space determine_spiff_color_space(const int32_t component_count) noexcept
+{
+    using enum spiff_color_space;
+    switch (component_count)
+    {
+    case 1:
+        return grayscale;
+    case 3:
+        return rgb;
+    case 2:
+    case 4:
+        return none; // SPIFF has no defined color space for gray + alpha and RGBA.
+
+    default:
+        std::unreachable();
+    }
+}
+
+void write_spiff_header(jpegls_encoder& encoder, const encoding_parameters& parameters)
+{
+    const auto color_space{determine_spiff_color_space(parameters.frame_info.component_count)};
+
+    if (const auto& resolution{parameters.resolution}; resolution.has_value())
+    {
+        encoder.write_standard_spiff_header(color_space, spiff_resolution_units::dots_per_inch, resolution->second,
+                                            resolution->first);
+    }
+    else
+    {
+        encoder.write_standard_spiff_header(color_space);
+    }
+}
+
+void write_original_components(jpegls_encoder& encoder, const encoding_parameters& parameters)
+{
+    if (const auto& original{parameters.source_components}; original.has_value())
+    {
+        const auto data{original->to_application_data()};
+        encoder.write_application_data(original_components::application_data_id, data.data(), data.size());
+    }
+
+    if (parameters.right_aligned)
+    {
+        const auto data{right_aligned_samples::to_application_data()};
+        encoder.write_application_data(right_aligned_samples::application_data_id, data.data(), data.size());
+    }
+}
+
+void write_palette(jpegls_encoder& encoder, const encoding_parameters& parameters)
+{
+    if (const auto& palette{parameters.palette}; palette.has_value())
+    {
+        encoder.write_mapping_table(mapping_table::table_id, palette->entry_size, palette->entries.data(),
+                                    palette->entries.size());
+        encoder.set_mapping_table_id(0, mapping_table::table_id);
+    }
+}
+
+// Returns the position of the SOS segment of an image encoded by CharLS.
+// When frame_height is provided, the height fields of the SOF55 segment and the SPIFF header are updated.
+[[nodiscard]]
+scan_position find_scan(const span<std::byte> encoded, const std::optional<uint32_t> frame_height)
+{
+    const auto position{find_first_scan(encoded)};
+    if (!position)
+        throw_hresult(error_fail);
+
+    if (frame_height)
+    {
+        set_frame_height(encoded, *position, *frame_height);
+    }
+
+    return *position;
+}
+
+// Copies 1 component of the interleaved pixels to a plane of line_count lines.
+template<typename SampleType>
+void extract_component(const span<const std::byte> source, const uint32_t stride, const size_t width,
+                       const size_t line_count, const size_t component_count, const size_t component,
+                       std::byte* destination) noexcept
+{
+    auto* samples{reinterpret_cast<SampleType*>(destination)};
+    for (size_t row{}; row != line_count; ++row)
+    {
+        const auto* pixels{reinterpret_cast<const SampleType*>(source.data() + (row * stride))};
+        for (size_t col{}, offset = component; col != width; ++col, offset += component_count)
+        {
+            samples[(row * width) + col] = pixels[offset];
+        }
+    }
+}
+
+void extract_component(const charls::frame_info& frame_info, const uint32_t line_count,
+                       const span<const std::byte> source, const uint32_t stride, const int32_t component,
+                       std::byte* destination) noexcept
+{
+    if (frame_info.bits_per_sample <= 8)
+    {
+        extract_component<std::byte>(source, stride, frame_info.width, line_count, frame_info.component_count,
+                                     component, destination);
+    }
+    else
+    {
+        extract_component<uint16_t>(source, stride, frame_info.width, line_count, frame_info.component_count,
+                                    component, destination);
+    }
+}
+
+[[nodiscard]]
+size_t plane_size(const charls::frame_info& frame_info, const uint32_t line_count) noexcept
+{
+    return static_cast<size_t>(frame_info.width) * line_count * (frame_info.bits_per_sample <= 8 ? 1 : 2);
+}
+
+// With interleave mode none every component is an independent scan. The scan of 1 component is identical to the scan
+// of a single component image with the same parameters: returns the entropy coded data of that image.
+[[nodiscard]]
+encoded_data encode_component(const encoding_parameters& parameters, const uint32_t line_count,
+                              const span<const std::byte> source, const uint32_t stride, const int32_t component)
+{
+    const auto& frame_info{parameters.frame_info};
+    const storage_buffer samples{plane_size(frame_info, line_count)};
+    extract_component(frame_info, line_count, source, stride, component, samples.data());
+
+    jpegls_encoder encoder;
+    encoder.frame_info({.width = frame_info.width,
+                        .height = line_count,
+                        .bits_per_sample = frame_info.bits_per_sample,
+                        .component_count = 1});
+    storage_buffer destination{encoder.estimated_destination_size()};
+    encoder.destination(destination.data(), destination.size());
+    encoder.near_lossless(parameters.near_lossless);
+    encoder.preset_coding_parameters(parameters.preset_coding_parameters);
+
+    const size_t bytes_written{encoder.encode(samples.data(), samples.size())};
+    const size_t entropy_coded_data{find_scan({destination.data(), bytes_written}, std::nullopt).entropy_coded_data};
+    return {std::move(destination), entropy_coded_data, bytes_written - entropy_coded_data - end_of_image_bytes.size()};
+}
+
+// Encodes the components of a frame without interleaving concurrently and concatenates the scans in component order.
+// The headers and the SOS segments are taken from an image with the first line of the frame, which is encoded with
+// the same parameters (the height fields are updated).
+[[nodiscard]]
+encoded_data encode_components(const encoding_parameters& parameters, const uint32_t line_count,
+                               const span<const std::byte> source, const uint32_t stride, const size_t reserved_size)
+{
+    const auto& frame_info{parameters.frame_info};
+    std::vector<std::future<encoded_data>> encoding_scans;
+    for (int32_t component{1}; component != frame_info.component_count; ++component)
+    {
+        encoding_scans.push_back(std::async(std::launch::async, [&parameters, line_count, source, stride, component] {
+            return encode_component(parameters, line_count, source, stride, component);
+        }));
+    }
+
+    jpegls_encoder encoder;
+    encoder.frame_info({.width = frame_info.width,
+                        .height = 1,
+                        .bits_per_sample = frame_info.bits_per_sample,
+                        .component_count = frame_info.component_count});
+    const storage_buffer headers{encoder.estimated_destination_size()};
+    encoder.destination(headers.data(), headers.size());
+    encoder.interleave_mode(charls::interleave_mode::none);
+    encoder.near_lossless(parameters.near_lossless);
+    encoder.preset_coding_parameters(parameters.preset_coding_parameters);
+    if (parameters.spiff_header)
+    {
+        write_spiff_header(encoder, parameters);
+    }
+
+    write_original_components(encoder, parameters);
+
+    const size_t line_size{plane_size(frame_info, 1)};
+    const storage_buffer first_line{line_size * frame_info.component_count};
+    for (int32_t component{}; component != frame_info.component_count; ++component)
+    {
+        extract_component(frame_info, 1, source, stride, component, first_line.data() + (component * line_size));
+    }
+
+    const size_t header_bytes_written{encoder.encode(first_line.data(), first_line.size())};
+    const auto scan{find_scan({headers.data(), header_bytes_written}, line_count)};
+    const size_t start_of_scan_position{scan.start_of_scan};
+    const size_t scan_header_size{scan.entropy_coded_data - start_of_scan_position};
+
+    std::vector<encoded_data> scans;
+    scans.push_back(encode_component(parameters, line_count, source, stride, 0));
+    for (auto& encoding_scan : encoding_scans)
+    {
+        scans.push_back(encoding_scan.get());
+    }
+
+    size_t size{reserved_size + start_of_scan_position + end_of_image_bytes.size()};
+    for (const auto& scan : scans)
+    {
+        size += scan_header_size + scan.bytes().size();
+    }
+
+    // The SOS segment of the first scan selects the first component (offset 5: Cs), the component IDs are consecutive.
+    constexpr size_t component_id_offset{5};
+    storage_buffer destination{size};
+    std::byte* position{std::copy_n(headers.data(), start_of_scan_position, destination.data() + reserved_size)};
+    for (size_t i{}; i != scans.size(); ++i)
+    {
+        std::byte* scan_header{position};
+        position = std::copy_n(headers.data() + start_of_scan_position, scan_header_size, position);
+        scan_header[component_id_offset] =
+            static_cast<std::byte>(std::to_integer<size_t>(scan_header[component_id_offset]) + i);
+        position = std::ranges::copy(scans[i].bytes(), position).out;
+    }
+
+    std::ranges::copy(end_of_image_bytes, position);
+    return {std::move(destination), reserved_size, size - reserved_size};
+}
+
+} // namespace
+
+encoded_data encode(const encoding_parameters& parameters, const uint32_t line_count, const span<const std::byte> source,
+                    const uint32_t stride, const size_t reserved_size)
+{
+    if (parameters.interleave_mode == charls::interleave_mode::none && parameters.frame_info.component_count > 1)
+        return encode_components(parameters, line_count, source, stride, reserved_size);
+
+    jpegls_encoder encoder;
+    encoder.frame_info({.width = parameters.frame_info.width,
+                        .height = line_count,
+                        .bits_per_sample = parameters.frame_info.bits_per_sample,
+                        .component_count = parameters.frame_info.component_count});
+
+    // The estimated size is pessimistic: use an uninitialized buffer, the pages that are not written are never touched.
+    storage_buffer destination{reserved_size + encoder.estimated_destination_size()};
+    encoder.destination(destination.data() + reserved_size, destination.size() - reserved_size);
+    encoder.interleave_mode(parameters.interleave_mode);
+    encoder.near_lossless(parameters.near_lossless);
+    encoder.color_transformation(parameters.color_transformation);
+    encoder.preset_coding_parameters(parameters.preset_coding_parameters);
+
+    if (parameters.spiff_header)
+    {
+        write_spiff_header(encoder, parameters);
+    }
+
+    write_original_components(encoder, parameters);
+    write_palette(encoder, parameters);
+
+    const size_t bytes_written{encoder.encode(source, stride)};
+    return {std::move(destination), reserved_size, bytes_written};
+}
+
+stripe_encoder::stripe_encoder(const encoding_parameters& parameters, const uint32_t stripe_height) noexcept :
+    parameters_{parameters}, stripe_height_{stripe_height}
+{
+    ASSERT(can_encode(parameters));
+    ASSERT(stripe_height > 0 && stripe_height <= std::numeric_limits<uint16_t>::max());
+}
+
+bool stripe_encoder::can_encode(const encoding_parameters& parameters) noexcept
+{
+    constexpr uint32_t maximum_size{std::numeric_limits<uint16_t>::max()};
+    return parameters.frame_info.width <= maximum_size && parameters.frame_info.height <= maximum_size &&
+           (parameters.frame_info.component_count == 1 || parameters.interleave_mode != charls::interleave_mode::none);
+}
+
+uint32_t stripe_encoder::default_stripe_height(const charls::frame_info& frame_info) noexcept
+{
+    constexpr size_t stripe_size{static_cast<size_t>(1024) * 1024};
+    constexpr uint32_t minimum_stripe_height{16};
+
+    const size_t line_size{static_cast<size_t>(frame_info.width) * frame_info.component_count *
+                           (frame_info.bits_per_sample <= 8 ? 1 : 2)};
+    const auto stripe_height{static_cast<uint32_t>(
+        std::clamp(stripe_size / std::max(line_size, size_t{1}), size_t{minimum_stripe_height},
+                   size_t{std::numeric_limits<uint16_t>::max()}))};
+    return std::max(std::min(stripe_height, frame_info.height), 1U);
+}
+
+encoded_data stripe_encoder::encode_stripe(const uint32_t stripe_index, const span<const std::byte> source,
+                                           const uint32_t stride) const
+{
+    ASSERT(stripe_index < stripe_count());
+
+    const bool insert_restart_interval{stripe_index == 0 && stripe_count() > 1};
+    auto encoded{encode(parameters_, line_count(stripe_index), source, stride,
+                        insert_restart_interval ? restart_interval_segment_size : 0)};
+
+    // Note: the encoded data is updated in place to prevent copying the entropy coded data.
+    const span bytes{encoded.buffer_.data() + encoded.offset_, encoded.size_};
+    ASSERT(bytes.size() > 2 && bytes[bytes.size() - 2] == marker_start && bytes[bytes.size() - 1] == end_of_image_marker);
+    encoded.size_ -= end_of_image_bytes.size();
+
+    if (stripe_count() == 1)
+        return encoded;
+
+    if (stripe_index == 0)
+    {
+        // Keep the headers (updated for the complete frame) and insert a DRI segment before the SOS segment.
+        // The space for the DRI segment is reserved in front of the encoded data.
+        const size_t start_of_scan_position{find_scan(bytes, parameters_.frame_info.height).start_of_scan};
+        std::byte* headers{encoded.buffer_.data()};
+        std::memmove(headers, bytes.data(), start_of_scan_position);
+
+        std::byte* restart_interval{headers + start_of_scan_position};
+        restart_interval[0] = marker_start;
+        restart_interval[1] = define_restart_interval;
+        write_uint16(&restart_interval[2], static_cast<uint32_t>(restart_interval_segment_size - 2));
+        write_uint16(&restart_interval[4], stripe_height_);
+
+        encoded.size_ += encoded.offset_;
+        encoded.offset_ = 0;
+        return encoded;
+    }
+
+    // Only the entropy coded data of the scan is needed, prefixed by the next restart marker.
+    // The restart marker overwrites the last 2 bytes of the SOS segment, which is not needed.
+    const size_t entropy_coded_data{find_scan(bytes, std::nullopt).entropy_coded_data};
+    std::byte* restart_marker{bytes.data() + entropy_coded_data - 2};
+    restart_marker[0] = marker_start;
+    restart_marker[1] = restart_marker0 | static_cast<std::byte>((stripe_index - 1) % restart_marker_range);
+
+    encoded.offset_ += entropy_coded_data - 2;
+    encoded.size_ -= entropy_coded_data - 2;
+    return encoded;
+}
+
+void stripe_encoder::encode_stripes(const span<const std::byte> source, const uint32_t stride,
+                                    const std::function<void(const encoded_data&)>& write) const
+{
+    std::vector<std::optional<encoded_data>> stripes(stripe_count());
+    std::mutex mutex;
+    std::condition_variable stripe_encoded;
+    std::exception_ptr error;
+    std::atomic<bool> stopped{};
+    std::atomic<uint32_t> next_stripe_index{};
+    const auto encode_next_stripes{[this, source, stride, &stripes, &mutex, &stripe_encoded, &error, &stopped,
+                                    &next_stripe_index] {
+        try
+        {
+            for (uint32_t i{next_stripe_index++}; i < stripe_count() && !stopped; i = next_stripe_index++)
+            {
+                encoded_data stripe{
+                    encode_stripe(i, source.subspan(static_cast<size_t>(i) * stripe_height_ * stride), stride)};
+                const std::scoped_lock lock{mutex};
+                stripes[i].emplace(std::move(stripe));
+                stripe_encoded.notify_one();
+            }
+        }
+        catch (...)
+        {
+            const std::scoped_lock lock{mutex};
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            stopped = true;
+            stripe_encoded.notify_one();
+        }
+    }};
+
+    // The calling thread writes the stripes (IStream is used on the thread of the caller).
+    const uint32_t worker_count{std::min(std::max(std::thread::hardware_concurrency(), 1U), stripe_count())};
+    std::vector<std::future<void>> workers;
+    workers.reserve(worker_count);
+    for (uint32_t i{}; i != worker_count; ++i)
+    {
+        workers.push_back(std::async(std::launch::async, encode_next_stripes));
+    }
+
+    try
+    {
+        for (auto& stripe : stripes)
+        {
+            std::optional<encoded_data> encoded;
+            {
+                std::unique_lock lock{mutex};
+                stripe_encoded.wait(lock, [&stripe, &error] { return stripe.has_value() || error; });
+                if (error)
+                    std::rethrow_exception(error);
+
+                encoded.emplace(std::move(*stripe));
+                stripe.reset();
+            }
+
+            write(*encoded); // The buffer of the stripe is released after it is written.
+        }
+    }
+    catch (...)
+    {
+        stopped = true; // The destructors of the futures wait for the workers.
+        throw;
+    }
+}
+
+span<const std::byte> stripe_encoder::end_of_image() noexcept
+{
+    return end_of_image_bytes;
+}
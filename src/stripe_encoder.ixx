@@ -0,0 +1,122 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+export module stripe_encoder;
+
+import std;
+import charls;
+
+import original_components;
+import storage_buffer;
+
+using std::uint32_t;
+
+// A palette, stored as a JPEG-LS mapping table: the samples of the image are indices in the table.
+export struct mapping_table final
+{
+    std::int32_t entry_size; // 3 (RGB) or 4 (RGBA) bytes per entry.
+    std::vector<std::byte> entries;
+
+    static constexpr std::int32_t table_id{1};
+};
+
+// Parameters that are applied to every JPEG-LS encoder instance used to encode a frame.
+export struct encoding_parameters final
+{
+    charls::frame_info frame_info;
+    charls::interleave_mode interleave_mode;
+    std::int32_t near_lossless;
+    charls::color_transformation color_transformation;
+    charls::jpegls_pc_parameters preset_coding_parameters; // Zero values: default parameters.
+    bool spiff_header;
+    std::optional<std::pair<uint32_t, uint32_t>> resolution;
+    std::optional<original_components> source_components; // Set when components are removed before encoding.
+    std::optional<mapping_table> palette;                  // Set for indexed images.
+    bool right_aligned;                                    // 9 to 15 bit samples that are not shifted when decoded.
+};
+
+export class stripe_encoder;
+
+// Encoded bytes, stored in an uninitialized buffer that is sized by the (pessimistic) estimate of the encoder.
+export class encoded_data final
+{
+public:
+    encoded_data(storage_buffer buffer, const size_t offset, const size_t size) noexcept :
+        buffer_{std::move(buffer)}, offset_{offset}, size_{size}
+    {
+    }
+
+    [[nodiscard]]
+    std::span<const std::byte> bytes() const noexcept
+    {
+        return {buffer_.data() + offset_, size_};
+    }
+
+private:
+    friend class stripe_encoder;
+
+    storage_buffer buffer_;
+    size_t offset_;
+    size_t size_;
+};
+
+// Purpose: encodes the first line_count lines of a frame as a complete JPEG-LS image (SPIFF header included when
+// enabled).
+// Optionally reserved_size bytes are kept free in front of the encoded bytes.
+export [[nodiscard]]
+encoded_data encode(const encoding_parameters& parameters, uint32_t line_count, std::span<const std::byte> source,
+                    uint32_t stride, size_t reserved_size = 0);
+
+// Purpose: encodes a frame as a sequence of stripes that can be written to the destination as soon as they are
+// available. Every stripe is encoded as an independent JPEG-LS image, the scans are stitched together into one scan
+// with restart markers (JPEG-LS resets its coding state at a restart marker, which makes this equivalent to encoding
+// the complete frame with a restart interval equal to the stripe height).
+export class stripe_encoder final
+{
+public:
+    stripe_encoder(const encoding_parameters& parameters, uint32_t stripe_height) noexcept;
+
+    // Stitching patches the 16 bit height fields of the SOF segment and requires 1 scan for all components.
+    [[nodiscard]]
+    static bool can_encode(const encoding_parameters& parameters) noexcept;
+
+    // Returns a stripe height that keeps the memory needed for the source lines of one stripe around 1 MiB.
+    [[nodiscard]]
+    static uint32_t default_stripe_height(const charls::frame_info& frame_info) noexcept;
+
+    [[nodiscard]]
+    uint32_t stripe_height() const noexcept
+    {
+        return stripe_height_;
+    }
+
+    [[nodiscard]]
+    uint32_t stripe_count() const noexcept
+    {
+        return (parameters_.frame_info.height + (stripe_height_ - 1)) / stripe_height_;
+    }
+
+    [[nodiscard]]
+    uint32_t line_count(const uint32_t stripe_index) const noexcept
+    {
+        return std::min(stripe_height_, parameters_.frame_info.height - (stripe_index * stripe_height_));
+    }
+
+    // Encodes the lines of 1 stripe and returns the bytes that must be appended to the destination (in stripe order).
+    // This method has no side effects: stripes can be encoded concurrently.
+    [[nodiscard]]
+    encoded_data encode_stripe(uint32_t stripe_index, std::span<const std::byte> source, uint32_t stride) const;
+
+    // Encodes the stripes of a complete frame on concurrent threads (at most 1 per processor). The calling thread passes
+    // every stripe to write in stripe order as soon as it is encoded, while the next stripes are still being encoded.
+    void encode_stripes(std::span<const std::byte> source, uint32_t stride,
+                        const std::function<void(const encoded_data&)>& write) const;
+
+    // Returns the bytes that must be appended after the last stripe.
+    [[nodiscard]]
+    static std::span<const std::byte> end_of_image() noexcept;
+
+private:
+    encoding_parameters parameters_;
+    uint32_t stripe_height_;
+};
@@ -100,6 +100,22 @@ export inline void check_condition(const bool condition, const winrt::hresult re
         throw_hresult(result_to_throw);
 }
 
+// Purpose: writes the bytes to the stream in blocks of a fixed size.
+// IStream::Write can only write ULONG bytes per call and large single writes are slow for streams that grow a buffer.
+export void write_to_stream(IStream& stream, span<const std::byte> bytes)
+{
+    constexpr size_t block_size{static_cast<size_t>(1024) * 1024};
+
+    while (!bytes.empty())
+    {
+        const auto size{static_cast<ULONG>(std::min(bytes.size(), block_size))};
+        ULONG bytes_written;
+        winrt::check_hresult(stream.Write(bytes.data(), size, &bytes_written));
+        check_condition(bytes_written == size, error_medium_full);
+        bytes = bytes.subspan(size);
+    }
+}
+
 export __declspec(noinline) HRESULT to_hresult() noexcept
 {
     try
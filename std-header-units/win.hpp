@@ -6,7 +6,7 @@
 #include <Windows.h>
 #include <Shlwapi.h>
 #include <wincodec.h>
-#include <mfapi.h>
+#include <wincodecsdk.h>
 #include <ShlObj.h>
 #include <olectl.h>
 #include <propkey.h>
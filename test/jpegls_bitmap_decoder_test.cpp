@@ -338,17 +338,100 @@ TEST_CLASS(jpegls_bitmap_decoder_test)
         Assert::AreEqual(wincodec::error_unsupported_pixel_format, result);
     }
 
-    TEST_METHOD(GetFrame_8_bit_2_components_is_not_supported) // NOLINT
+    TEST_METHOD(QueryCapability_can_decode_12_bit_rgb) // NOLINT
     {
-        const vector<std::byte> pixel_data(2);
-        auto encoded_data = charls::jpegls_encoder::encode(
-            pixel_data, {.width = 1, .height = 1, .bits_per_sample = 8, .component_count = 2});
-        const auto bitmap_decoder{create_decoder(encoded_data)};
+        const vector<uint16_t> pixel_data(static_cast<size_t>(5) * 3 * 3, 0x0ABC);
+        const auto encoded_data{charls::jpegls_encoder::encode(
+            pixel_data, {.width = 5, .height = 3, .bits_per_sample = 12, .component_count = 3},
+            charls::interleave_mode::sample)};
+        const com_ptr<IStream> stream{
+            SHCreateMemStream(reinterpret_cast<const BYTE*>(encoded_data.data()), static_cast<UINT>(encoded_data.size())),
+            take_ownership_from_abi};
 
-        com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
-        const HRESULT result{bitmap_decoder->GetFrame(0, bitmap_frame_decode.put())};
+        DWORD capability;
+        const HRESULT result{com_factory_.create_decoder()->QueryCapability(stream.get(), &capability)};
 
-        Assert::AreEqual(wincodec::error_unsupported_pixel_format, result);
+        Assert::AreEqual(success_ok, result);
+        Assert::AreEqual(static_cast<DWORD>(WICBitmapDecoderCapabilityCanDecodeAllImages), capability);
+    }
+
+    TEST_METHOD(GetFrame_10_bit_rgb_is_decoded_as_48_bit_rgb) // NOLINT
+    {
+        constexpr uint32_t width{7};
+        constexpr uint32_t height{3};
+        vector<uint16_t> pixel_data(static_cast<size_t>(width) * height * 3);
+        for (size_t i{}; i != pixel_data.size(); ++i)
+        {
+            pixel_data[i] = static_cast<uint16_t>((i * 97) % 1024);
+        }
+
+        for (const auto interleave_mode : {charls::interleave_mode::none, charls::interleave_mode::sample})
+        {
+            const auto encoded_data{charls::jpegls_encoder::encode(
+                pixel_data, {.width = width, .height = height, .bits_per_sample = 10, .component_count = 3},
+                interleave_mode)};
+            const auto bitmap_decoder{create_decoder(encoded_data)};
+
+            com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
+            check_hresult(bitmap_decoder->GetFrame(0, bitmap_frame_decode.put()));
+
+            GUID pixel_format;
+            check_hresult(bitmap_frame_decode->GetPixelFormat(&pixel_format));
+            Assert::IsTrue(GUID_WICPixelFormat48bppRGB == pixel_format);
+
+            // The samples are shifted to the most significant bits of the 16 bit samples.
+            constexpr uint32_t stride{(width * 3 * 2) + 2};
+            vector<uint16_t> pixels(static_cast<size_t>(stride) * height / 2);
+            check_hresult(bitmap_frame_decode->CopyPixels(nullptr, stride, stride * height,
+                                                          reinterpret_cast<BYTE*>(pixels.data())));
+            for (size_t row{}; row != height; ++row)
+            {
+                for (size_t i{}; i != static_cast<size_t>(width) * 3; ++i)
+                {
+                    Assert::AreEqual(static_cast<uint16_t>(pixel_data[(row * width * 3) + i] << 6),
+                                     pixels[(row * stride / 2) + i]);
+                }
+            }
+        }
+    }
+
+    TEST_METHOD(GetFrame_gray_alpha_is_decoded_as_32_bit_rgba) // NOLINT
+    {
+        constexpr uint32_t width{19};
+        constexpr uint32_t height{3};
+        vector<std::byte> pixel_data(static_cast<size_t>(width) * height * 2);
+        for (size_t i{}; i != pixel_data.size(); ++i)
+        {
+            pixel_data[i] = static_cast<std::byte>(i * 13);
+        }
+
+        for (const auto interleave_mode : {charls::interleave_mode::none, charls::interleave_mode::sample})
+        {
+            const auto encoded_data{charls::jpegls_encoder::encode(
+                pixel_data, {.width = width, .height = height, .bits_per_sample = 8, .component_count = 2},
+                interleave_mode)};
+            const auto bitmap_decoder{create_decoder(encoded_data)};
+
+            com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
+            check_hresult(bitmap_decoder->GetFrame(0, bitmap_frame_decode.put()));
+
+            GUID pixel_format;
+            check_hresult(bitmap_frame_decode->GetPixelFormat(&pixel_format));
+            Assert::IsTrue(GUID_WICPixelFormat32bppRGBA == pixel_format);
+
+            // The gray sample is replicated to R, G and B.
+            constexpr uint32_t stride{width * 4};
+            vector<std::byte> pixels(static_cast<size_t>(stride) * height);
+            check_hresult(bitmap_frame_decode->CopyPixels(nullptr, stride, static_cast<uint32_t>(pixels.size()),
+                                                          reinterpret_cast<BYTE*>(pixels.data())));
+            for (size_t i{}; i != static_cast<size_t>(width) * height; ++i)
+            {
+                Assert::IsTrue(pixel_data[i * 2] == pixels[i * 4]);
+                Assert::IsTrue(pixel_data[i * 2] == pixels[(i * 4) + 1]);
+                Assert::IsTrue(pixel_data[i * 2] == pixels[(i * 4) + 2]);
+                Assert::IsTrue(pixel_data[(i * 2) + 1] == pixels[(i * 4) + 3]);
+            }
+        }
     }
 
     TEST_METHOD(GetFrame_empty_buffer_causes_bad_header) // NOLINT
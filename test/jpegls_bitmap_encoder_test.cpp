@@ -10,6 +10,7 @@ import winrt_base;
 import hresults;
 import guids;
 import charls;
+import encoder_options;
 
 import com_factory;
 import portable_anymap_file;
@@ -235,6 +236,61 @@ constexpr void convert_rgb_to_bgr_in_place(const span<std::byte> pixels, const s
     }
 }
 
+
+// Property bag that only has the near lossless option, the other properties fail with property_result.
+struct near_lossless_property_bag : winrt::implements<near_lossless_property_bag, IPropertyBag2>
+{
+    explicit near_lossless_property_bag(const HRESULT property_result) noexcept : property_result_{property_result}
+    {
+    }
+
+    HRESULT __stdcall Read(const ULONG count, PROPBAG2* properties, IErrorLog* /*error_log*/, VARIANT* values,
+                           HRESULT* results) noexcept override
+    {
+        for (ULONG i{}; i != count; ++i)
+        {
+            if (std::wstring_view{properties[i].pstrName} == encoder_option_name::near_lossless)
+            {
+                values[i].vt = VT_UI1;
+                values[i].bVal = 2;
+                results[i] = success_ok;
+            }
+            else
+            {
+                values[i].vt = VT_EMPTY;
+                results[i] = property_result_;
+            }
+        }
+
+        return error_fail;
+    }
+
+    HRESULT __stdcall Write(ULONG /*count*/, PROPBAG2* /*properties*/, VARIANT* /*values*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall CountProperties(ULONG* /*count*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall GetPropertyInfo(ULONG /*property*/, ULONG /*count*/, PROPBAG2* /*properties*/,
+                                      ULONG* /*count_properties*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall LoadObject(LPCOLESTR /*name*/, DWORD /*hint*/, IUnknown* /*unknown*/,
+                                 IErrorLog* /*error_log*/) noexcept override
+    {
+        return error_fail;
+    }
+
+private:
+    HRESULT property_result_;
+};
+
 } // namespace
 
 
@@ -399,7 +455,62 @@ TEST_CLASS(jpegls_bitmap_encoder_test)
         result = encoder->CreateNewFrame(frame_encode.put(), property_bag.put());
         Assert::AreEqual(success_ok, result);
         Assert::IsNotNull(frame_encode.get());
-        Assert::IsNull(property_bag.get());
+        Assert::IsNotNull(property_bag.get());
+
+        ULONG count;
+        result = property_bag->CountProperties(&count);
+        Assert::AreEqual(success_ok, result);
+        Assert::AreEqual(static_cast<ULONG>(encoder_options::option_count), count);
+    }
+
+    TEST_METHOD(Initialize_frame_with_invalid_encoder_option) // NOLINT
+    {
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+
+        const com_ptr encoder{com_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        com_ptr<IPropertyBag2> property_bag;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+        write_option(*property_bag, encoder_option_name::interleave_mode, 3);
+
+        const HRESULT result{frame_encode->Initialize(property_bag.get())};
+        Assert::AreEqual(error_invalid_argument, result);
+    }
+
+    TEST_METHOD(Initialize_frame_with_missing_encoder_options) // NOLINT
+    {
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+
+        const com_ptr encoder{com_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+
+        const com_ptr<IPropertyBag2> property_bag{
+            winrt::make<near_lossless_property_bag>(wincodec::error_property_not_found)};
+        const HRESULT result{frame_encode->Initialize(property_bag.get())};
+        Assert::AreEqual(success_ok, result);
+    }
+
+    TEST_METHOD(Initialize_frame_with_unconvertible_encoder_option) // NOLINT
+    {
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+
+        const com_ptr encoder{com_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+
+        const com_ptr<IPropertyBag2> property_bag{winrt::make<near_lossless_property_bag>(DISP_E_TYPEMISMATCH)};
+        const HRESULT result{frame_encode->Initialize(property_bag.get())};
+        Assert::AreEqual(error_invalid_argument, result);
     }
 
     TEST_METHOD(CreateNewFrame_with_nullptr) // NOLINT
@@ -722,92 +833,120 @@ TEST_CLASS(jpegls_bitmap_encoder_test)
         compare(destination_filename, anymap_pixels);
     }
 
-    TEST_METHOD(encode_unsupported_format) // NOLINT
+    TEST_METHOD(encode_no_cache_multiple_stripes) // NOLINT
     {
-        const wchar_t* filename{L"encode_unsupported_format.jls"};
-
-        com_ptr<IStream> stream;
-        check_hresult(SHCreateStreamOnFileEx(filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE, 0, false,
-                                             nullptr, stream.put()));
+        const wchar_t* destination_filename{L"encode_no_cache_multiple_stripes.jls"};
+        constexpr uint32_t width{1024};
+        constexpr uint32_t height{1100}; // Multiple stripes with a smaller last stripe.
+        constexpr uint32_t stride{width * 2};
 
-        const com_ptr encoder{com_factory_.create_encoder()};
-        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+        vector<std::byte> pixels(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != pixels.size() / 2; ++i)
+        {
+            const auto value{static_cast<uint16_t>(((i % width) * 7) ^ (i / width))};
+            pixels[i * 2] = static_cast<std::byte>(value);
+            pixels[(i * 2) + 1] = static_cast<std::byte>(value >> 8);
+        }
 
-        vector<std::byte> input_data(4);
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(destination_filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE,
+                                                 0, false, nullptr, stream.put()));
 
-        com_ptr<IWICBitmap> bitmap;
-        check_hresult(imaging_factory()->CreateBitmapFromMemory(32, 1, GUID_WICPixelFormatBlackWhite, 4,
-                                                                static_cast<uint32_t>(input_data.size()),
-                                                                reinterpret_cast<BYTE*>(input_data.data()), bitmap.put()));
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
 
-        com_ptr<IWICBitmapFrameEncode> frame_encode;
-        HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
-        Assert::AreEqual(success_ok, result);
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat16bppGray};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+
+            constexpr uint32_t band_height{100};
+            for (uint32_t line{}; line < height; line += band_height)
+            {
+                const uint32_t line_count{std::min(band_height, height - line)};
+                check_hresult(frame_encode->WritePixels(line_count, stride, stride * line_count,
+                                                        reinterpret_cast<BYTE*>(pixels.data() + (line * stride))));
+            }
 
-        result = frame_encode->Initialize(nullptr);
-        Assert::AreEqual(success_ok, result);
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
 
-        result = frame_encode->WriteSource(bitmap.get(), nullptr);
-        Assert::AreEqual(wincodec::error_unsupported_pixel_format, result);
+        compare(destination_filename, pixels);
     }
 
-    TEST_METHOD(encode_with_dpi_set) // NOLINT
+    TEST_METHOD(encode_no_cache_bgr_in_bands) // NOLINT
     {
-        const wchar_t* filename{L"encode_dpi_set.jls"};
-        constexpr double expected_dpi_x{100.};
-        constexpr double expected_dpi_y{75.};
+        const wchar_t* destination_filename{L"encode_no_cache_bgr_in_bands.jls"};
+        constexpr uint32_t width{601};
+        constexpr uint32_t height{1500}; // Multiple stripes, encoded while the next bands are delivered.
+        constexpr uint32_t stride{((width * 3) + 3) / 4 * 4};
 
+        vector<std::byte> rgb_pixels(static_cast<size_t>(width) * height * 3);
+        for (size_t i{}; i != rgb_pixels.size(); ++i)
         {
-            portable_anymap_file anymap_file{"test8.ppm"};
-            com_ptr<IStream> stream;
-            check_hresult(SHCreateStreamOnFileEx(filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE, 0, false,
-                                                 nullptr, stream.put()));
+            rgb_pixels[i] = static_cast<std::byte>((i * 13) ^ (i / (width * 3)));
+        }
 
-            const com_ptr encoder{com_factory_.create_encoder()};
-            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+        vector<std::byte> bgr_pixels(static_cast<size_t>(stride) * height);
+        for (size_t row{}; row != height; ++row)
+        {
+            std::copy_n(rgb_pixels.data() + (row * width * 3), width * 3, bgr_pixels.data() + (row * stride));
+            convert_rgb_to_bgr_in_place(span{bgr_pixels.data() + (row * stride), width * 3}, 3);
+        }
 
-            const GUID pixel_format{get_pixel_format(anymap_file.bits_per_sample(), anymap_file.component_count())};
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(destination_filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE,
+                                                 0, false, nullptr, stream.put()));
 
-            com_ptr<IWICBitmap> bitmap;
-            check_hresult(imaging_factory()->CreateBitmapFromMemory(
-                anymap_file.width(), anymap_file.height(), pixel_format, anymap_file.width() * anymap_file.component_count(),
-                static_cast<uint32_t>(anymap_file.image_data().size()),
-                reinterpret_cast<BYTE*>(anymap_file.image_data().data()), bitmap.put()));
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
 
             com_ptr<IWICBitmapFrameEncode> frame_encode;
-            HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
-            Assert::AreEqual(success_ok, result);
-
-            result = frame_encode->Initialize(nullptr);
-            Assert::AreEqual(success_ok, result);
-
-            result = frame_encode->SetResolution(expected_dpi_x, expected_dpi_y);
-            Assert::AreEqual(success_ok, result);
-
-            result = frame_encode->WriteSource(bitmap.get(), nullptr);
-            Assert::AreEqual(success_ok, result);
-
-            result = frame_encode->Commit();
-            Assert::AreEqual(success_ok, result);
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat24bppBGR};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+
+            constexpr uint32_t band_height{64};
+            for (uint32_t line{}; line < height; line += band_height)
+            {
+                const uint32_t line_count{std::min(band_height, height - line)};
+                check_hresult(frame_encode->WritePixels(line_count, stride, stride * line_count,
+                                                        reinterpret_cast<BYTE*>(bgr_pixels.data() + (line * stride))));
+            }
 
-            result = encoder->Commit();
-            Assert::AreEqual(success_ok, result);
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
         }
 
-        const auto frame_decoder{create_frame_decoder(filename)};
-        double dpi_x{};
-        double dpi_y{};
-
-        const HRESULT result{frame_decoder->GetResolution(&dpi_x, &dpi_y)};
-        Assert::AreEqual(success_ok, result);
-        Assert::AreEqual(expected_dpi_x, dpi_x);
-        Assert::AreEqual(expected_dpi_y, dpi_y);
+        compare(destination_filename, rgb_pixels);
     }
 
-private:
-    void encode_monochrome_2_bit(const char* source_filename, const wchar_t* destination_filename) const
+    TEST_METHOD(encode_bgra_write_pixels_odd_width) // NOLINT
     {
-        portable_anymap_file anymap_file{source_filename};
+        const wchar_t* destination_filename{L"encode_bgra_write_pixels_odd_width.jls"};
+        constexpr uint32_t width{37}; // Not a multiple of the pixel count of the vectorized conversion.
+        constexpr uint32_t height{9};
+        constexpr uint32_t stride{(width * 4) + 12}; // Padding bytes must be ignored.
+
+        vector<std::byte> rgba_pixels(static_cast<size_t>(width) * height * 4);
+        for (size_t i{}; i != rgba_pixels.size(); ++i)
+        {
+            rgba_pixels[i] = static_cast<std::byte>(i * 7);
+        }
+
+        vector<std::byte> bgra_pixels(static_cast<size_t>(stride) * height, std::byte{0xCD});
+        for (size_t row{}; row != height; ++row)
+        {
+            std::copy_n(rgba_pixels.data() + (row * width * 4), width * 4, bgra_pixels.data() + (row * stride));
+            convert_rgb_to_bgr_in_place(span{bgra_pixels.data() + (row * stride), width * 4}, 4);
+        }
 
         {
             com_ptr<IStream> stream;
@@ -817,42 +956,34 @@ TEST_CLASS(jpegls_bitmap_encoder_test)
             const com_ptr encoder{com_factory_.create_encoder()};
             check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
 
-            const GUID pixel_format{get_pixel_format(anymap_file.bits_per_sample(), anymap_file.component_count())};
-
-            const uint32_t stride{compute_stride({.width = static_cast<uint32_t>(anymap_file.width()),
-                                                  .height = static_cast<uint32_t>(anymap_file.height()),
-                                                  .bits_per_sample = 2,
-                                                  .component_count = 1})};
-
-            auto nibble_pixels{pack_to_crumbs(anymap_file.image_data(), anymap_file.width(), anymap_file.height(), stride)};
-            com_ptr<IWICBitmap> bitmap;
-            check_hresult(imaging_factory()->CreateBitmapFromMemory(
-                anymap_file.width(), anymap_file.height(), pixel_format, stride, static_cast<uint32_t>(nibble_pixels.size()),
-                reinterpret_cast<BYTE*>(nibble_pixels.data()), bitmap.put()));
-
             com_ptr<IWICBitmapFrameEncode> frame_encode;
-            HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
-            Assert::AreEqual(success_ok, result);
-
-            result = frame_encode->Initialize(nullptr);
-            Assert::AreEqual(success_ok, result);
-
-            result = frame_encode->WriteSource(bitmap.get(), nullptr);
-            Assert::AreEqual(success_ok, result);
-
-            result = frame_encode->Commit();
-            Assert::AreEqual(success_ok, result);
-
-            result = encoder->Commit();
-            Assert::AreEqual(success_ok, result);
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat32bppBGRA};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(bgra_pixels.size()),
+                                                    reinterpret_cast<BYTE*>(bgra_pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
         }
 
-        compare(destination_filename, anymap_file.image_data());
+        compare(destination_filename, rgba_pixels);
     }
 
-    void encode_monochrome_4_bit(const char* source_filename, const wchar_t* destination_filename) const
+    TEST_METHOD(encode_no_cache_4_bit_multiple_stripes) // NOLINT
     {
-        portable_anymap_file anymap_file{source_filename};
+        const wchar_t* destination_filename{L"encode_no_cache_4_bit_multiple_stripes.jls"};
+        constexpr uint32_t width{2001};
+        constexpr uint32_t height{1200}; // Multiple stripes: the pixel buffers are reused.
+        const uint32_t stride{compute_stride({.width = width, .height = height, .bits_per_sample = 4, .component_count = 1})};
+
+        vector<std::byte> pixels(static_cast<size_t>(width) * height);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<std::byte>(((i * 5) ^ (i / width)) & 0x0F);
+        }
+        auto nibble_pixels{pack_to_nibbles(pixels, width, height, stride)};
 
         {
             com_ptr<IStream> stream;
@@ -860,65 +991,1267 @@ TEST_CLASS(jpegls_bitmap_encoder_test)
                                                  0, false, nullptr, stream.put()));
 
             const com_ptr encoder{com_factory_.create_encoder()};
-            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
 
-            const GUID pixel_format{get_pixel_format(anymap_file.bits_per_sample(), anymap_file.component_count())};
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat4bppGray};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(nibble_pixels.size()),
+                                                    reinterpret_cast<BYTE*>(nibble_pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
 
-            const uint32_t stride{compute_stride({.width = static_cast<uint32_t>(anymap_file.width()),
-                                                  .height = static_cast<uint32_t>(anymap_file.height()),
-                                                  .bits_per_sample = 4,
-                                                  .component_count = 1})};
+        compare(destination_filename, pixels);
+    }
 
-            auto nibble_pixels{pack_to_nibbles(anymap_file.image_data(), anymap_file.width(), anymap_file.height(), stride)};
-            com_ptr<IWICBitmap> bitmap;
-            check_hresult(imaging_factory()->CreateBitmapFromMemory(
-                anymap_file.width(), anymap_file.height(), pixel_format, stride, static_cast<uint32_t>(nibble_pixels.size()),
-                reinterpret_cast<BYTE*>(nibble_pixels.data()), bitmap.put()));
+    TEST_METHOD(encode_with_encoder_options) // NOLINT
+    {
+        constexpr uint32_t width{97};
+        constexpr uint32_t height{31};
+        constexpr uint32_t stride{((width * 3) + 3) / 4 * 4};
+        constexpr int32_t near_lossless{2};
 
-            com_ptr<IWICBitmapFrameEncode> frame_encode;
-            HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
-            Assert::AreEqual(success_ok, result);
+        vector<std::byte> pixels(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<std::byte>((i * 3) ^ (i / stride));
+        }
 
-            result = frame_encode->Initialize(nullptr);
-            Assert::AreEqual(success_ok, result);
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
 
-            result = frame_encode->WriteSource(bitmap.get(), nullptr);
-            Assert::AreEqual(success_ok, result);
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::near_lossless, near_lossless);
+            write_option(*property_bag, encoder_option_name::interleave_mode, 1); // line
+
+            VARIANT spiff_header{};
+            spiff_header.vt = VT_BOOL;
+            spiff_header.boolVal = VARIANT_FALSE;
+            PROPBAG2 option{};
+            option.pstrName = const_cast<LPOLESTR>(encoder_option_name::spiff_header);
+            check_hresult(property_bag->Write(1, &option, &spiff_header));
+
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat24bppRGB};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(pixels.size()),
+                                                    reinterpret_cast<BYTE*>(pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
 
-            result = frame_encode->Commit();
-            Assert::AreEqual(success_ok, result);
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
 
-            result = encoder->Commit();
-            Assert::AreEqual(success_ok, result);
-        }
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        Assert::IsFalse(decoder.read_spiff_header());
+        decoder.read_header();
+        Assert::AreEqual(near_lossless, decoder.get_near_lossless());
+        Assert::IsTrue(charls::interleave_mode::line == decoder.get_interleave_mode());
 
-        compare(destination_filename, anymap_file.image_data());
+        vector<std::byte> destination(decoder.get_destination_size());
+        decoder.decode(destination);
+        for (size_t row{}; row != height; ++row)
+        {
+            for (size_t i{}; i != static_cast<size_t>(width) * 3; ++i)
+            {
+                const int difference{std::to_integer<int>(pixels[(row * stride) + i]) -
+                                     std::to_integer<int>(destination[(row * width * 3) + i])};
+                Assert::IsTrue(std::abs(difference) <= near_lossless);
+            }
+        }
     }
 
-    void encode_conformance_color_lossless(const wchar_t* filename, const bool br_swap)
+    TEST_METHOD(encode_with_interleave_mode_none) // NOLINT
     {
-        portable_anymap_file anymap_file{"test8.ppm"};
+        constexpr uint32_t width{45};
+        constexpr uint32_t height{13};
+        constexpr uint32_t stride{width * 4};
 
+        vector<std::byte> pixels(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != pixels.size(); ++i)
         {
-            com_ptr<IStream> stream;
-            check_hresult(SHCreateStreamOnFileEx(filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE, 0, false,
-                                                 nullptr, stream.put()));
+            pixels[i] = static_cast<std::byte>((i * 7) ^ (i / stride));
+        }
 
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
             const com_ptr encoder{com_factory_.create_encoder()};
             check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
 
-            const GUID pixel_format{get_pixel_format(anymap_file.bits_per_sample(), anymap_file.component_count(), br_swap)};
-
-            vector<std::byte> input_data{anymap_file.image_data().cbegin(), anymap_file.image_data().cend()};
-            if (br_swap)
-            {
-                convert_rgb_to_bgr_in_place(input_data, 3);
-            }
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::interleave_mode, 0);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat32bppRGBA};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(pixels.size()),
+                                                    reinterpret_cast<BYTE*>(pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
 
-            com_ptr<IWICBitmap> bitmap;
-            check_hresult(imaging_factory()->CreateBitmapFromMemory(
-                anymap_file.width(), anymap_file.height(), pixel_format, anymap_file.width() * anymap_file.component_count(),
-                static_cast<uint32_t>(input_data.size()), reinterpret_cast<BYTE*>(input_data.data()), bitmap.put()));
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::IsTrue(charls::interleave_mode::none == decoder.get_interleave_mode());
+
+        // The decoder returns the components as separate planes.
+        vector<std::byte> planes(decoder.get_destination_size());
+        decoder.decode(planes);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            const size_t component{i % 4};
+            Assert::IsTrue(pixels[i] == planes[(component * width * height) + (i / 4)]);
+        }
+    }
+
+    TEST_METHOD(encode_with_interleave_mode_none_16_bit_near_lossless) // NOLINT
+    {
+        constexpr uint32_t width{67};
+        constexpr uint32_t height{29};
+        constexpr int32_t near_lossless{3};
+
+        vector<uint16_t> pixels(static_cast<size_t>(width) * height * 3);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<uint16_t>((i * 1031) ^ (i / width));
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::interleave_mode, 0);
+            write_option(*property_bag, encoder_option_name::near_lossless, near_lossless);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat48bppRGB};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            constexpr uint32_t stride{((width * 6) + 3) / 4 * 4};
+            vector<std::byte> source(static_cast<size_t>(stride) * height);
+            for (size_t row{}; row != height; ++row)
+            {
+                std::memcpy(source.data() + (row * stride), pixels.data() + (row * width * 3), width * 6);
+            }
+
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(source.size()),
+                                                    reinterpret_cast<BYTE*>(source.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        // The scans of the components are encoded separately, the headers must describe the complete frame.
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        Assert::IsTrue(decoder.read_spiff_header());
+        decoder.read_header();
+        Assert::AreEqual(height, decoder.frame_info().height);
+        Assert::AreEqual(3, decoder.frame_info().component_count);
+        Assert::AreEqual(near_lossless, decoder.get_near_lossless());
+
+        vector<uint16_t> planes(decoder.get_destination_size() / 2);
+        decoder.decode(planes);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            const int difference{pixels[i] - planes[((i % 3) * width * height) + (i / 3)]};
+            Assert::IsTrue(std::abs(difference) <= near_lossless);
+        }
+    }
+
+    TEST_METHOD(encode_with_auto_significant_bits) // NOLINT
+    {
+        constexpr uint32_t width{61};
+        constexpr uint32_t height{23};
+        constexpr uint32_t stride{((width * 2) + 3) / 4 * 4};
+
+        // 12 bit samples, left-aligned in the 16 bit pixels.
+        vector<std::byte> source(static_cast<size_t>(stride) * height);
+        for (size_t row{}; row != height; ++row)
+        {
+            for (size_t column{}; column != width; ++column)
+            {
+                const auto sample{static_cast<uint16_t>((((row * 251) ^ (column * 37)) % 4096) << 4)};
+                std::memcpy(source.data() + (row * stride) + (column * 2), &sample, sizeof sample);
+            }
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::auto_significant_bits, 1);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat16bppGray};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(source.size()),
+                                                    reinterpret_cast<BYTE*>(source.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::AreEqual(12, decoder.frame_info().bits_per_sample);
+
+        vector<uint16_t> samples(decoder.get_destination_size() / 2);
+        decoder.decode(samples);
+        for (size_t i{}; i != samples.size(); ++i)
+        {
+            uint16_t sample;
+            std::memcpy(&sample, source.data() + ((i / width) * stride) + ((i % width) * 2), sizeof sample);
+            Assert::AreEqual(static_cast<uint16_t>(sample >> 4), samples[i]);
+        }
+    }
+
+    TEST_METHOD(encode_with_auto_significant_bits_right_aligned) // NOLINT
+    {
+        constexpr uint32_t width{61};
+        constexpr uint32_t height{23};
+        constexpr uint32_t stride{((width * 2) + 3) / 4 * 4};
+
+        // 12 bit samples, right-aligned in the 16 bit pixels.
+        vector<std::byte> source(static_cast<size_t>(stride) * height);
+        for (size_t row{}; row != height; ++row)
+        {
+            for (size_t column{}; column != width; ++column)
+            {
+                const auto sample{static_cast<uint16_t>((((row * 251) ^ (column * 37)) % 4096) | 1)};
+                std::memcpy(source.data() + (row * stride) + (column * 2), &sample, sizeof sample);
+            }
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::auto_significant_bits, 1);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat16bppGray};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(source.size()),
+                                                    reinterpret_cast<BYTE*>(source.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        // The samples are encoded with the bit depth of the largest sample.
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::AreEqual(12, decoder.frame_info().bits_per_sample);
+
+        // The samples are returned unchanged by the WIC decoder.
+        check_hresult(IStream_Reset(stream.get()));
+        const com_ptr bitmap_decoder{com_factory_.create_decoder()};
+        check_hresult(bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnLoad));
+        com_ptr<IWICBitmapFrameDecode> frame_decode;
+        check_hresult(bitmap_decoder->GetFrame(0, frame_decode.put()));
+
+        GUID decoded_pixel_format;
+        check_hresult(frame_decode->GetPixelFormat(&decoded_pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat16bppGray == decoded_pixel_format);
+
+        vector<std::byte> decoded(source.size());
+        check_hresult(frame_decode->CopyPixels(nullptr, stride, static_cast<uint32_t>(decoded.size()),
+                                               reinterpret_cast<BYTE*>(decoded.data())));
+        for (size_t row{}; row != height; ++row)
+        {
+            Assert::IsTrue(std::equal(source.begin() + static_cast<std::ptrdiff_t>(row * stride),
+                                      source.begin() + static_cast<std::ptrdiff_t>((row * stride) + (width * 2)),
+                                      decoded.begin() + static_cast<std::ptrdiff_t>(row * stride)));
+        }
+    }
+
+    TEST_METHOD(encode_with_significant_bits) // NOLINT
+    {
+        constexpr uint32_t width{19};
+        constexpr uint32_t height{11};
+        constexpr int32_t significant_bits{10};
+
+        vector<uint16_t> pixels(static_cast<size_t>(width) * height * 3);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<uint16_t>(((i * 613) % 1024) << (16 - significant_bits));
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            com_ptr<IWICBitmap> bitmap;
+            check_hresult(imaging_factory()->CreateBitmapFromMemory(
+                width, height, GUID_WICPixelFormat48bppRGB, width * 6, static_cast<uint32_t>(pixels.size() * 2),
+                reinterpret_cast<BYTE*>(pixels.data()), bitmap.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::significant_bits, significant_bits);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->WriteSource(bitmap.get(), nullptr));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::AreEqual(significant_bits, decoder.frame_info().bits_per_sample);
+
+        vector<uint16_t> samples(decoder.get_destination_size() / 2);
+        decoder.decode(samples);
+        for (size_t i{}; i != samples.size(); ++i)
+        {
+            Assert::AreEqual(static_cast<uint16_t>(pixels[i] >> (16 - significant_bits)), samples[i]);
+        }
+    }
+
+    TEST_METHOD(encode_opaque_bgra_with_reduce_components) // NOLINT
+    {
+        constexpr uint32_t width{37};
+        constexpr uint32_t height{13};
+        constexpr uint32_t stride{width * 4};
+
+        vector<std::byte> bgra_pixels(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != bgra_pixels.size(); ++i)
+        {
+            bgra_pixels[i] = i % 4 == 3 ? std::byte{0xFF} : static_cast<std::byte>(i * 11);
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::reduce_components, 1);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat32bppBGRA};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(bgra_pixels.size()),
+                                                    reinterpret_cast<BYTE*>(bgra_pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::AreEqual(3, decoder.frame_info().component_count);
+
+        // The decoder restores the alpha component.
+        check_hresult(IStream_Reset(stream.get()));
+        const com_ptr bitmap_decoder{com_factory_.create_decoder()};
+        check_hresult(bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnLoad));
+        com_ptr<IWICBitmapFrameDecode> frame_decode;
+        check_hresult(bitmap_decoder->GetFrame(0, frame_decode.put()));
+
+        GUID pixel_format;
+        check_hresult(frame_decode->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat32bppRGBA == pixel_format);
+
+        vector<std::byte> rgba_pixels(bgra_pixels.size());
+        check_hresult(frame_decode->CopyPixels(nullptr, stride, static_cast<uint32_t>(rgba_pixels.size()),
+                                               reinterpret_cast<BYTE*>(rgba_pixels.data())));
+        convert_rgb_to_bgr_in_place(span{rgba_pixels}, 4);
+        Assert::IsTrue(bgra_pixels == rgba_pixels);
+    }
+
+    TEST_METHOD(encode_neutral_rgb_with_reduce_components) // NOLINT
+    {
+        constexpr uint32_t width{41};
+        constexpr uint32_t height{7};
+        constexpr uint32_t stride{((width * 3) + 3) / 4 * 4};
+
+        vector<std::byte> pixels(static_cast<size_t>(stride) * height);
+        for (size_t row{}; row != height; ++row)
+        {
+            for (size_t column{}; column != width; ++column)
+            {
+                const auto value{static_cast<std::byte>((row * 29) + (column * 3))};
+                std::fill_n(pixels.data() + (row * stride) + (column * 3), 3, value);
+            }
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::reduce_components, 1);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat24bppRGB};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(pixels.size()),
+                                                    reinterpret_cast<BYTE*>(pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::AreEqual(1, decoder.frame_info().component_count);
+
+        vector<std::byte> gray(decoder.get_destination_size());
+        decoder.decode(gray);
+        for (size_t i{}; i != gray.size(); ++i)
+        {
+            Assert::IsTrue(pixels[((i / width) * stride) + ((i % width) * 3)] == gray[i]);
+        }
+    }
+
+    TEST_METHOD(encode_neutral_bgra_with_reduce_components) // NOLINT
+    {
+        constexpr uint32_t width{29};
+        constexpr uint32_t height{5};
+        constexpr uint32_t stride{width * 4};
+
+        vector<std::byte> bgra_pixels(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != bgra_pixels.size(); i += 4)
+        {
+            std::fill_n(bgra_pixels.data() + i, 3, static_cast<std::byte>(i * 7));
+            bgra_pixels[i + 3] = static_cast<std::byte>(i * 3);
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::reduce_components, 1);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat32bppBGRA};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(bgra_pixels.size()),
+                                                    reinterpret_cast<BYTE*>(bgra_pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::AreEqual(2, decoder.frame_info().component_count);
+
+        // The decoder expands gray + alpha to RGBA.
+        check_hresult(IStream_Reset(stream.get()));
+        const com_ptr bitmap_decoder{com_factory_.create_decoder()};
+        check_hresult(bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnLoad));
+        com_ptr<IWICBitmapFrameDecode> frame_decode;
+        check_hresult(bitmap_decoder->GetFrame(0, frame_decode.put()));
+
+        GUID pixel_format;
+        check_hresult(frame_decode->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat32bppRGBA == pixel_format);
+
+        vector<std::byte> rgba_pixels(bgra_pixels.size());
+        check_hresult(frame_decode->CopyPixels(nullptr, stride, static_cast<uint32_t>(rgba_pixels.size()),
+                                               reinterpret_cast<BYTE*>(rgba_pixels.data())));
+        Assert::IsTrue(bgra_pixels == rgba_pixels);
+    }
+
+    TEST_METHOD(encode_bgra_16_bit) // NOLINT
+    {
+        constexpr uint32_t width{13};
+        constexpr uint32_t height{9};
+        constexpr uint32_t stride{width * 8};
+
+        vector<std::uint16_t> bgra_pixels(static_cast<size_t>(width) * height * 4);
+        for (size_t i{}; i != bgra_pixels.size(); ++i)
+        {
+            bgra_pixels[i] = static_cast<std::uint16_t>(i * 1031);
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat64bppBGRA};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, stride * height,
+                                                    reinterpret_cast<BYTE*>(bgra_pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        check_hresult(IStream_Reset(stream.get()));
+        const com_ptr bitmap_decoder{com_factory_.create_decoder()};
+        check_hresult(bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnLoad));
+        com_ptr<IWICBitmapFrameDecode> frame_decode;
+        check_hresult(bitmap_decoder->GetFrame(0, frame_decode.put()));
+
+        GUID pixel_format;
+        check_hresult(frame_decode->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat64bppRGBA == pixel_format);
+
+        vector<std::uint16_t> rgba_pixels(bgra_pixels.size());
+        check_hresult(frame_decode->CopyPixels(nullptr, stride, stride * height,
+                                               reinterpret_cast<BYTE*>(rgba_pixels.data())));
+        for (size_t i{}; i != bgra_pixels.size(); i += 4)
+        {
+            Assert::AreEqual(bgra_pixels[i], rgba_pixels[i + 2]);
+            Assert::AreEqual(bgra_pixels[i + 1], rgba_pixels[i + 1]);
+            Assert::AreEqual(bgra_pixels[i + 2], rgba_pixels[i]);
+            Assert::AreEqual(bgra_pixels[i + 3], rgba_pixels[i + 3]);
+        }
+    }
+
+    TEST_METHOD(encode_bilevel) // NOLINT
+    {
+        constexpr uint32_t width{43};
+        constexpr uint32_t height{11};
+        constexpr uint32_t stride{8};
+        constexpr std::byte last_byte_mask{0xE0}; // 43 % 8 = 3 pixels.
+
+        vector<std::byte> bits(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != bits.size(); ++i)
+        {
+            bits[i] = static_cast<std::byte>(i * 37);
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormatBlackWhite};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(bits.size()),
+                                                    reinterpret_cast<BYTE*>(bits.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::AreEqual(2, decoder.frame_info().bits_per_sample);
+        Assert::AreEqual(1, decoder.preset_coding_parameters().maximum_sample_value);
+
+        check_hresult(IStream_Reset(stream.get()));
+        const com_ptr bitmap_decoder{com_factory_.create_decoder()};
+        check_hresult(bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnLoad));
+        com_ptr<IWICBitmapFrameDecode> frame_decode;
+        check_hresult(bitmap_decoder->GetFrame(0, frame_decode.put()));
+
+        GUID pixel_format;
+        check_hresult(frame_decode->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormatBlackWhite == pixel_format);
+
+        vector<std::byte> decoded_bits(bits.size());
+        check_hresult(frame_decode->CopyPixels(nullptr, stride, static_cast<uint32_t>(decoded_bits.size()),
+                                               reinterpret_cast<BYTE*>(decoded_bits.data())));
+        for (size_t row{}; row != height; ++row)
+        {
+            for (size_t i{}; i != width / 8; ++i)
+            {
+                Assert::IsTrue(bits[(row * stride) + i] == decoded_bits[(row * stride) + i]);
+            }
+
+            Assert::IsTrue((bits[(row * stride) + (width / 8)] & last_byte_mask) ==
+                           (decoded_bits[(row * stride) + (width / 8)] & last_byte_mask));
+        }
+    }
+
+    TEST_METHOD(encode_indexed_with_palette) // NOLINT
+    {
+        constexpr uint32_t width{41};
+        constexpr uint32_t height{17};
+        constexpr uint32_t stride{44};
+
+        vector<std::byte> indices(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != indices.size(); ++i)
+        {
+            indices[i] = static_cast<std::byte>((i / 7) % 16);
+        }
+
+        std::array<WICColor, 16> colors;
+        for (uint32_t i{}; i != colors.size(); ++i)
+        {
+            colors[i] = 0x80000000 | (i * 0x00100F01);
+        }
+
+        com_ptr<IWICPalette> palette;
+        check_hresult(imaging_factory()->CreatePalette(palette.put()));
+        check_hresult(palette->InitializeCustom(colors.data(), static_cast<uint32_t>(colors.size())));
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat8bppIndexed};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->SetPalette(palette.get()));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(indices.size()),
+                                                    reinterpret_cast<BYTE*>(indices.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        // The decoder returns the indices and the palette.
+        check_hresult(IStream_Reset(stream.get()));
+        const com_ptr bitmap_decoder{com_factory_.create_decoder()};
+        check_hresult(bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnLoad));
+        com_ptr<IWICBitmapFrameDecode> frame_decode;
+        check_hresult(bitmap_decoder->GetFrame(0, frame_decode.put()));
+
+        GUID pixel_format;
+        check_hresult(frame_decode->GetPixelFormat(&pixel_format));
+        Assert::IsTrue(GUID_WICPixelFormat8bppIndexed == pixel_format);
+
+        vector<std::byte> decoded_indices(indices.size());
+        check_hresult(frame_decode->CopyPixels(nullptr, stride, static_cast<uint32_t>(decoded_indices.size()),
+                                               reinterpret_cast<BYTE*>(decoded_indices.data())));
+        for (uint32_t row{}; row != height; ++row)
+        {
+            Assert::IsTrue(std::equal(indices.begin() + (row * stride), indices.begin() + (row * stride) + width,
+                                      decoded_indices.begin() + (row * stride)));
+        }
+
+        com_ptr<IWICPalette> decoded_palette;
+        check_hresult(imaging_factory()->CreatePalette(decoded_palette.put()));
+        check_hresult(frame_decode->CopyPalette(decoded_palette.get()));
+
+        std::array<WICColor, 16> decoded_colors{};
+        uint32_t color_count;
+        check_hresult(decoded_palette->GetColors(static_cast<uint32_t>(decoded_colors.size()), decoded_colors.data(),
+                                                 &color_count));
+        Assert::AreEqual(static_cast<uint32_t>(colors.size()), color_count);
+        Assert::IsTrue(colors == decoded_colors);
+    }
+
+    TEST_METHOD(encode_no_cache_with_auto_parameters) // NOLINT
+    {
+        const wchar_t* destination_filename{L"encode_no_cache_with_auto_parameters.jls"};
+        constexpr uint32_t width{600};
+        constexpr uint32_t height{1300}; // Multiple stripes, the parameters are selected with the first stripe.
+        constexpr uint32_t stride{width * 3};
+
+        vector<std::byte> pixels(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<std::byte>(((i % stride) / 3) + (i / stride));
+        }
+
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(destination_filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE,
+                                                 0, false, nullptr, stream.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+            write_option(*property_bag, encoder_option_name::auto_parameters, 1);
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat24bppRGB};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(pixels.size()),
+                                                    reinterpret_cast<BYTE*>(pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        compare(destination_filename, pixels);
+    }
+
+    TEST_METHOD(encode_with_target_size) // NOLINT
+    {
+        constexpr uint32_t width{256};
+        constexpr uint32_t height{256};
+        constexpr uint32_t target_size{width * height / 3};
+
+        // Noise can't be compressed lossless to a third of its size.
+        vector<std::byte> pixels(static_cast<size_t>(width) * height);
+        uint32_t random{1};
+        for (auto& pixel : pixels)
+        {
+            random = (random * 1664525) + 1013904223;
+            pixel = static_cast<std::byte>(random >> 24);
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+
+            VARIANT value{};
+            value.vt = VT_UI4;
+            value.ulVal = target_size;
+            PROPBAG2 option{};
+            option.pstrName = const_cast<LPOLESTR>(encoder_option_name::target_size);
+            check_hresult(property_bag->Write(1, &option, &value));
+
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat8bppGray};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, width, static_cast<uint32_t>(pixels.size()),
+                                                    reinterpret_cast<BYTE*>(pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        vector<std::byte> encoded(stat.cbSize.LowPart);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Read(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+
+        // The size is estimated from sampled lines: allow a small deviation.
+        Assert::IsTrue(encoded.size() <= target_size + (target_size / 10));
+
+        jpegls_decoder decoder;
+        decoder.source(encoded);
+        decoder.read_header();
+        Assert::IsTrue(decoder.get_near_lossless() > 0);
+    }
+
+    TEST_METHOD(encode_with_restart_interval) // NOLINT
+    {
+        const wchar_t* destination_filename{L"encode_with_restart_interval.jls"};
+        constexpr uint32_t width{100};
+        constexpr uint32_t height{103}; // Not a multiple of the restart interval.
+        constexpr uint32_t stride{width * 3};
+        constexpr int32_t restart_interval{8};
+
+        vector<std::byte> pixels(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<std::byte>((i * 5) ^ (i / stride));
+        }
+
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(destination_filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE,
+                                                 0, false, nullptr, stream.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+
+            VARIANT value{};
+            value.vt = VT_UI2;
+            value.uiVal = restart_interval;
+            PROPBAG2 option{};
+            option.pstrName = const_cast<LPOLESTR>(encoder_option_name::restart_interval);
+            check_hresult(property_bag->Write(1, &option, &value));
+
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat24bppRGB};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, stride, static_cast<uint32_t>(pixels.size()),
+                                                    reinterpret_cast<BYTE*>(pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        // The DRI segment defines the restart interval, the scan contains (height - 1) / interval restart markers.
+        const auto encoded{read_file(destination_filename)};
+        constexpr std::array define_restart_interval{std::byte{0xFF}, std::byte{0xDD}, std::byte{0}, std::byte{4},
+                                                     std::byte{0}, std::byte{restart_interval}};
+        Assert::IsFalse(std::ranges::search(encoded, define_restart_interval).empty());
+
+        size_t restart_marker_count{};
+        for (size_t i{}; i + 1 < encoded.size(); ++i)
+        {
+            if (encoded[i] == std::byte{0xFF} && (encoded[i + 1] & std::byte{0xF8}) == std::byte{0xD0})
+            {
+                ++restart_marker_count;
+            }
+        }
+
+        Assert::AreEqual(static_cast<size_t>((height - 1) / restart_interval), restart_marker_count);
+        compare(destination_filename, pixels);
+    }
+
+    TEST_METHOD(encode_write_source_rectangle_in_parts) // NOLINT
+    {
+        const wchar_t* destination_filename{L"encode_write_source_rectangle_in_parts.jls"};
+        constexpr uint32_t source_width{64};
+        constexpr uint32_t source_height{48};
+        constexpr uint32_t source_stride{source_width * 3};
+        constexpr WICRect crop{5, 7, 30, 20};
+
+        vector<std::byte> source_pixels(static_cast<size_t>(source_stride) * source_height);
+        for (size_t i{}; i != source_pixels.size(); ++i)
+        {
+            source_pixels[i] = static_cast<std::byte>((i * 11) ^ (i / source_stride));
+        }
+
+        vector<std::byte> expected;
+        for (auto row{static_cast<size_t>(crop.Y)}; row != static_cast<size_t>(crop.Y) + crop.Height; ++row)
+        {
+            const auto* first{source_pixels.data() + (row * source_stride) + (static_cast<size_t>(crop.X) * 3)};
+            expected.insert(expected.end(), first, first + (static_cast<size_t>(crop.Width) * 3));
+        }
+
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(destination_filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE,
+                                                 0, false, nullptr, stream.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmap> bitmap;
+            check_hresult(imaging_factory()->CreateBitmapFromMemory(
+                source_width, source_height, GUID_WICPixelFormat24bppRGB, source_stride,
+                static_cast<uint32_t>(source_pixels.size()), reinterpret_cast<BYTE*>(source_pixels.data()), bitmap.put()));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->SetSize(crop.Width, crop.Height));
+
+            // The lines of the rectangles are appended, like the lines of WritePixels.
+            WICRect top{crop.X, crop.Y, crop.Width, 12};
+            check_hresult(frame_encode->WriteSource(bitmap.get(), &top));
+            WICRect bottom{crop.X, crop.Y + 12, crop.Width, crop.Height - 12};
+            check_hresult(frame_encode->WriteSource(bitmap.get(), &bottom));
+
+            WICRect outside{crop.X, crop.Y, source_width, 1};
+            Assert::AreEqual(error_invalid_argument, frame_encode->WriteSource(bitmap.get(), &outside));
+
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        compare(destination_filename, expected);
+    }
+
+    TEST_METHOD(encode_write_source_from_locked_bitmap) // NOLINT
+    {
+        const wchar_t* destination_filename{L"encode_write_source_from_locked_bitmap.jls"};
+        constexpr uint32_t width{77};
+        constexpr uint32_t height{31};
+        constexpr uint32_t stride{80};
+
+        vector<std::byte> pixels(static_cast<size_t>(stride) * height);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<std::byte>((i * 3) ^ (i / stride));
+        }
+
+        com_ptr<IWICBitmap> bitmap;
+        check_hresult(imaging_factory()->CreateBitmapFromMemory(width, height, GUID_WICPixelFormat8bppGray, stride,
+                                                                static_cast<uint32_t>(pixels.size()),
+                                                                reinterpret_cast<BYTE*>(pixels.data()), bitmap.put()));
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(destination_filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE,
+                                                 0, false, nullptr, stream.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+            check_hresult(frame_encode->Initialize(nullptr));
+            check_hresult(frame_encode->WriteSource(bitmap.get(), nullptr));
+
+            // The frame encodes directly from the memory of the bitmap: it holds a read lock until the encoder commits.
+            const WICRect rectangle{0, 0, static_cast<int32_t>(width), static_cast<int32_t>(height)};
+            com_ptr<IWICBitmapLock> write_lock;
+            Assert::AreEqual(wincodec::error_already_locked,
+                             bitmap->Lock(&rectangle, WICBitmapLockWrite, write_lock.put()));
+
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+
+            // The frame is still referenced, but the lock is released.
+            check_hresult(bitmap->Lock(&rectangle, WICBitmapLockWrite, write_lock.put()));
+        }
+
+        vector<std::byte> expected;
+        for (size_t row{}; row != height; ++row)
+        {
+            expected.insert(expected.end(), pixels.data() + (row * stride), pixels.data() + (row * stride) + width);
+        }
+
+        compare(destination_filename, expected);
+    }
+
+    TEST_METHOD(encode_no_cache_commit_with_missing_lines) // NOLINT
+    {
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+
+        const com_ptr encoder{com_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+        check_hresult(frame_encode->Initialize(nullptr));
+        check_hresult(frame_encode->SetSize(512, 512));
+        GUID pixel_format{GUID_WICPixelFormat8bppGray};
+        check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+
+        vector<std::byte> pixels(512 * 256);
+        check_hresult(
+            frame_encode->WritePixels(256, 512, static_cast<uint32_t>(pixels.size()), reinterpret_cast<BYTE*>(pixels.data())));
+
+        const HRESULT result{frame_encode->Commit()};
+        Assert::AreEqual(wincodec::error_wrong_state, result);
+    }
+
+    TEST_METHOD(encode_no_cache_set_resolution_after_write_pixels) // NOLINT
+    {
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+
+        const com_ptr encoder{com_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderNoCache));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        check_hresult(encoder->CreateNewFrame(frame_encode.put(), nullptr));
+        check_hresult(frame_encode->Initialize(nullptr));
+        check_hresult(frame_encode->SetSize(512, 512));
+        GUID pixel_format{GUID_WICPixelFormat8bppGray};
+        check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+
+        vector<std::byte> pixels(512 * 10);
+        check_hresult(
+            frame_encode->WritePixels(10, 512, static_cast<uint32_t>(pixels.size()), reinterpret_cast<BYTE*>(pixels.data())));
+
+        // The header with the resolution is already prepared: a new resolution can't be applied anymore.
+        const HRESULT result{frame_encode->SetResolution(300., 300.)};
+        Assert::AreEqual(wincodec::error_wrong_state, result);
+    }
+
+    TEST_METHOD(encode_unsupported_format) // NOLINT
+    {
+        const wchar_t* filename{L"encode_unsupported_format.jls"};
+
+        com_ptr<IStream> stream;
+        check_hresult(SHCreateStreamOnFileEx(filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE, 0, false,
+                                             nullptr, stream.put()));
+
+        const com_ptr encoder{com_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+        vector<std::byte> input_data(32 * 4);
+
+        com_ptr<IWICBitmap> bitmap;
+        check_hresult(imaging_factory()->CreateBitmapFromMemory(32, 1, GUID_WICPixelFormat32bppCMYK, 32 * 4,
+                                                                static_cast<uint32_t>(input_data.size()),
+                                                                reinterpret_cast<BYTE*>(input_data.data()), bitmap.put()));
+
+        com_ptr<IWICBitmapFrameEncode> frame_encode;
+        HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
+        Assert::AreEqual(success_ok, result);
+
+        result = frame_encode->Initialize(nullptr);
+        Assert::AreEqual(success_ok, result);
+
+        result = frame_encode->WriteSource(bitmap.get(), nullptr);
+        Assert::AreEqual(wincodec::error_unsupported_pixel_format, result);
+    }
+
+    TEST_METHOD(encode_with_dpi_set) // NOLINT
+    {
+        const wchar_t* filename{L"encode_dpi_set.jls"};
+        constexpr double expected_dpi_x{100.};
+        constexpr double expected_dpi_y{75.};
+
+        {
+            portable_anymap_file anymap_file{"test8.ppm"};
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE, 0, false,
+                                                 nullptr, stream.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            const GUID pixel_format{get_pixel_format(anymap_file.bits_per_sample(), anymap_file.component_count())};
+
+            com_ptr<IWICBitmap> bitmap;
+            check_hresult(imaging_factory()->CreateBitmapFromMemory(
+                anymap_file.width(), anymap_file.height(), pixel_format, anymap_file.width() * anymap_file.component_count(),
+                static_cast<uint32_t>(anymap_file.image_data().size()),
+                reinterpret_cast<BYTE*>(anymap_file.image_data().data()), bitmap.put()));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->Initialize(nullptr);
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->SetResolution(expected_dpi_x, expected_dpi_y);
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->WriteSource(bitmap.get(), nullptr);
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->Commit();
+            Assert::AreEqual(success_ok, result);
+
+            result = encoder->Commit();
+            Assert::AreEqual(success_ok, result);
+        }
+
+        const auto frame_decoder{create_frame_decoder(filename)};
+        double dpi_x{};
+        double dpi_y{};
+
+        const HRESULT result{frame_decoder->GetResolution(&dpi_x, &dpi_y)};
+        Assert::AreEqual(success_ok, result);
+        Assert::AreEqual(expected_dpi_x, dpi_x);
+        Assert::AreEqual(expected_dpi_y, dpi_y);
+    }
+
+private:
+    void encode_monochrome_2_bit(const char* source_filename, const wchar_t* destination_filename) const
+    {
+        portable_anymap_file anymap_file{source_filename};
+
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(destination_filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE,
+                                                 0, false, nullptr, stream.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            const GUID pixel_format{get_pixel_format(anymap_file.bits_per_sample(), anymap_file.component_count())};
+
+            const uint32_t stride{compute_stride({.width = static_cast<uint32_t>(anymap_file.width()),
+                                                  .height = static_cast<uint32_t>(anymap_file.height()),
+                                                  .bits_per_sample = 2,
+                                                  .component_count = 1})};
+
+            auto nibble_pixels{pack_to_crumbs(anymap_file.image_data(), anymap_file.width(), anymap_file.height(), stride)};
+            com_ptr<IWICBitmap> bitmap;
+            check_hresult(imaging_factory()->CreateBitmapFromMemory(
+                anymap_file.width(), anymap_file.height(), pixel_format, stride, static_cast<uint32_t>(nibble_pixels.size()),
+                reinterpret_cast<BYTE*>(nibble_pixels.data()), bitmap.put()));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->Initialize(nullptr);
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->WriteSource(bitmap.get(), nullptr);
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->Commit();
+            Assert::AreEqual(success_ok, result);
+
+            result = encoder->Commit();
+            Assert::AreEqual(success_ok, result);
+        }
+
+        compare(destination_filename, anymap_file.image_data());
+    }
+
+    void encode_monochrome_4_bit(const char* source_filename, const wchar_t* destination_filename) const
+    {
+        portable_anymap_file anymap_file{source_filename};
+
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(destination_filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE,
+                                                 0, false, nullptr, stream.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            const GUID pixel_format{get_pixel_format(anymap_file.bits_per_sample(), anymap_file.component_count())};
+
+            const uint32_t stride{compute_stride({.width = static_cast<uint32_t>(anymap_file.width()),
+                                                  .height = static_cast<uint32_t>(anymap_file.height()),
+                                                  .bits_per_sample = 4,
+                                                  .component_count = 1})};
+
+            auto nibble_pixels{pack_to_nibbles(anymap_file.image_data(), anymap_file.width(), anymap_file.height(), stride)};
+            com_ptr<IWICBitmap> bitmap;
+            check_hresult(imaging_factory()->CreateBitmapFromMemory(
+                anymap_file.width(), anymap_file.height(), pixel_format, stride, static_cast<uint32_t>(nibble_pixels.size()),
+                reinterpret_cast<BYTE*>(nibble_pixels.data()), bitmap.put()));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->Initialize(nullptr);
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->WriteSource(bitmap.get(), nullptr);
+            Assert::AreEqual(success_ok, result);
+
+            result = frame_encode->Commit();
+            Assert::AreEqual(success_ok, result);
+
+            result = encoder->Commit();
+            Assert::AreEqual(success_ok, result);
+        }
+
+        compare(destination_filename, anymap_file.image_data());
+    }
+
+    void encode_conformance_color_lossless(const wchar_t* filename, const bool br_swap)
+    {
+        portable_anymap_file anymap_file{"test8.ppm"};
+
+        {
+            com_ptr<IStream> stream;
+            check_hresult(SHCreateStreamOnFileEx(filename, STGM_READWRITE | STGM_CREATE | STGM_SHARE_DENY_WRITE, 0, false,
+                                                 nullptr, stream.put()));
+
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            const GUID pixel_format{get_pixel_format(anymap_file.bits_per_sample(), anymap_file.component_count(), br_swap)};
+
+            vector<std::byte> input_data{anymap_file.image_data().cbegin(), anymap_file.image_data().cend()};
+            if (br_swap)
+            {
+                convert_rgb_to_bgr_in_place(input_data, 3);
+            }
+
+            com_ptr<IWICBitmap> bitmap;
+            check_hresult(imaging_factory()->CreateBitmapFromMemory(
+                anymap_file.width(), anymap_file.height(), pixel_format, anymap_file.width() * anymap_file.component_count(),
+                static_cast<uint32_t>(input_data.size()), reinterpret_cast<BYTE*>(input_data.data()), bitmap.put()));
 
             com_ptr<IWICBitmapFrameEncode> frame_encode;
             HRESULT result{encoder->CreateNewFrame(frame_encode.put(), nullptr)};
@@ -1021,6 +2354,17 @@ TEST_CLASS(jpegls_bitmap_encoder_test)
         return bitmap_frame_decode;
     }
 
+    static void write_option(IPropertyBag2& property_bag, const wchar_t* name, const int32_t value)
+    {
+        PROPBAG2 option{};
+        option.pstrName = const_cast<LPOLESTR>(name);
+
+        VARIANT variant{};
+        variant.vt = VT_UI1;
+        variant.bVal = static_cast<BYTE>(value);
+        check_hresult(property_bag.Write(1, &option, &variant));
+    }
+
     static void compare(const wchar_t* filename, const span<const std::byte> decoded_source)
     {
         const auto encoded_source{read_file(filename)};
@@ -11,7 +11,9 @@ import hresults;
 import com_factory;
 import portable_anymap_file;
 import portable_arbitrary_map;
+import test_stream;
 import charls;
+import encoder_options;
 
 import "macros.hpp";
 
@@ -312,14 +314,253 @@ TEST_CLASS(jpegls_bitmap_frame_decode_test)
                                              false, nullptr, stream.put()));
 
         const com_ptr wic_bitmap_decoder{com_factory_.create_decoder()};
-        check_hresult(wic_bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+        check_hresult(wic_bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnLoad));
 
         com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
         const HRESULT result{wic_bitmap_decoder->GetFrame(0, bitmap_frame_decode.put())};
         Assert::AreEqual(wincodec::error_bad_image, result);
     }
 
+    TEST_METHOD(decode_bad_image_on_demand) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"tulips-gray-8bit-512-512-bad.jls")};
+
+        const auto [width, height]{get_size(*bitmap_frame_decoder)};
+        vector<std::byte> buffer(static_cast<size_t>(width) * height);
+        const HRESULT result{copy_pixels<std::byte>(*bitmap_frame_decoder.get(), width, buffer)};
+        Assert::AreEqual(wincodec::error_bad_image, result);
+    }
+
+    TEST_METHOD(CopyPixels_rectangle_on_demand_equals_on_load) // NOLINT
+    {
+        const com_ptr on_demand{create_frame_decoder(L"tulips-gray-8bit-512-512.jls", WICDecodeMetadataCacheOnDemand)};
+        const com_ptr on_load{create_frame_decoder(L"tulips-gray-8bit-512-512.jls", WICDecodeMetadataCacheOnLoad)};
+
+        for (const WICRect rectangle : {WICRect{10, 20, 100, 50}, WICRect{0, 500, 512, 12}, WICRect{3, 0, 1, 512}})
+        {
+            constexpr uint32_t stride{512};
+            vector<std::byte> expected(static_cast<size_t>(stride) * rectangle.Height);
+            check_hresult(on_load->CopyPixels(&rectangle, stride, static_cast<uint32_t>(expected.size()),
+                                              reinterpret_cast<BYTE*>(expected.data())));
+
+            vector<std::byte> actual(expected.size());
+            check_hresult(on_demand->CopyPixels(&rectangle, stride, static_cast<uint32_t>(actual.size()),
+                                                reinterpret_cast<BYTE*>(actual.data())));
+
+            for (int32_t row{}; row != rectangle.Height; ++row)
+            {
+                const auto offset{static_cast<size_t>(row) * stride};
+                Assert::IsTrue(std::equal(expected.begin() + offset, expected.begin() + offset + rectangle.Width,
+                                          actual.begin() + offset));
+            }
+        }
+    }
+
+    TEST_METHOD(CopyPixels_rectangle_on_demand_4_bit_odd_offset) // NOLINT
+    {
+        const com_ptr on_demand{create_frame_decoder(L"4bit-monochrome.jls", WICDecodeMetadataCacheOnDemand)};
+        const com_ptr on_load{create_frame_decoder(L"4bit-monochrome.jls", WICDecodeMetadataCacheOnLoad)};
+
+        const auto [width, height]{get_size(*on_load)};
+        const WICRect rectangle{1, 1, static_cast<int32_t>(width - 1), static_cast<int32_t>(height - 1)};
+        const uint32_t stride{(width + 7) / 8 * 4};
+        vector<std::byte> expected(static_cast<size_t>(stride) * height);
+        check_hresult(on_load->CopyPixels(&rectangle, stride, static_cast<uint32_t>(expected.size()),
+                                          reinterpret_cast<BYTE*>(expected.data())));
+
+        vector<std::byte> actual(expected.size());
+        check_hresult(on_demand->CopyPixels(&rectangle, stride, static_cast<uint32_t>(actual.size()),
+                                            reinterpret_cast<BYTE*>(actual.data())));
+
+        const vector expected_pixels{unpack_nibbles(expected.data(), width - 1, height - 1, stride)};
+        const vector actual_pixels{unpack_nibbles(actual.data(), width - 1, height - 1, stride)};
+        Assert::IsTrue(expected_pixels == actual_pixels);
+    }
+
+    TEST_METHOD(CopyPixels_rectangle_on_demand_out_of_bounds) // NOLINT
+    {
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(L"tulips-gray-8bit-512-512.jls")};
+
+        const WICRect rectangle{500, 0, 100, 1};
+        array<std::byte, 100> buffer{};
+        const HRESULT result{bitmap_frame_decoder->CopyPixels(&rectangle, static_cast<uint32_t>(buffer.size()),
+                                                              static_cast<uint32_t>(buffer.size()),
+                                                              reinterpret_cast<BYTE*>(buffer.data()))};
+        Assert::AreEqual(error_invalid_argument, result);
+    }
+
+    TEST_METHOD(decode_memory_access_stream) // NOLINT
+    {
+        // The stand-in stream fails every Read call: decoding only succeeds when the memory is accessed directly.
+        const com_ptr<IStream> stream{make<memory_access_stream>(read_file(L"tulips-gray-8bit-512-512.jls"))};
+
+        for (const WICDecodeOptions cache_options : {WICDecodeMetadataCacheOnLoad, WICDecodeMetadataCacheOnDemand})
+        {
+            check_hresult(stream->Seek({}, STREAM_SEEK_SET, nullptr));
+            const com_ptr bitmap_frame_decoder{create_frame_decoder(stream.get(), cache_options)};
+            decode_and_compare(*bitmap_frame_decoder, "tulips-gray-8bit-512-512.pgm");
+        }
+    }
+
+    TEST_METHOD(decode_hglobal_stream) // NOLINT
+    {
+        const vector encoded{read_file(L"tulips-gray-8bit-512-512.jls")};
+        com_ptr<IStream> stream;
+        check_hresult(CreateStreamOnHGlobal(nullptr, true, stream.put()));
+        check_hresult(IStream_Write(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+        check_hresult(IStream_Reset(stream.get()));
+
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(stream.get(), WICDecodeMetadataCacheOnDemand)};
+        decode_and_compare(*bitmap_frame_decoder, "tulips-gray-8bit-512-512.pgm");
+    }
+
+    TEST_METHOD(decode_hglobal_stream_modified_after_create) // NOLINT
+    {
+        const vector encoded{read_file(L"tulips-gray-8bit-512-512.jls")};
+        com_ptr<IStream> stream;
+        check_hresult(CreateStreamOnHGlobal(nullptr, true, stream.put()));
+        check_hresult(IStream_Write(stream.get(), encoded.data(), static_cast<ULONG>(encoded.size())));
+        check_hresult(IStream_Reset(stream.get()));
+
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(stream.get(), WICDecodeMetadataCacheOnDemand)};
+
+        // Overwrite and grow the stream (the HGLOBAL is reallocated): the frame decoder keeps its own copy.
+        const vector<std::byte> other_data(encoded.size() * 4);
+        check_hresult(IStream_Reset(stream.get()));
+        check_hresult(IStream_Write(stream.get(), other_data.data(), static_cast<ULONG>(other_data.size())));
+
+        decode_and_compare(*bitmap_frame_decoder, "tulips-gray-8bit-512-512.pgm");
+    }
+
+    TEST_METHOD(decode_mapped_file_stream) // NOLINT
+    {
+        // A file stream created with an absolute path reports that path: the file is mapped instead of read.
+        const std::filesystem::path path{std::filesystem::absolute(L"tulips-gray-8bit-512-512.jls")};
+        com_ptr<IStream> stream;
+        check_hresult(
+            SHCreateStreamOnFileEx(path.c_str(), STGM_READ | STGM_SHARE_DENY_WRITE, 0, false, nullptr, stream.put()));
+
+        for (const WICDecodeOptions cache_options : {WICDecodeMetadataCacheOnLoad, WICDecodeMetadataCacheOnDemand})
+        {
+            check_hresult(IStream_Reset(stream.get()));
+            const com_ptr bitmap_frame_decoder{create_frame_decoder(stream.get(), cache_options)};
+            decode_and_compare(*bitmap_frame_decoder, "tulips-gray-8bit-512-512.pgm");
+        }
+    }
+
+    TEST_METHOD(CopyPixels_strips_on_demand_restart_intervals) // NOLINT
+    {
+        // The image is larger than one band: the strips are decoded from the restart intervals of multiple bands.
+        constexpr uint32_t width{1024};
+        constexpr uint32_t height{4500};
+        vector<std::byte> pixels(static_cast<size_t>(width) * height);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<std::byte>((i % width) ^ (i / width));
+        }
+
+        com_ptr<IStream> stream;
+        check_hresult(CreateStreamOnHGlobal(nullptr, true, stream.put()));
+        {
+            const com_ptr encoder{com_factory_.create_encoder()};
+            check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+
+            com_ptr<IWICBitmapFrameEncode> frame_encode;
+            com_ptr<IPropertyBag2> property_bag;
+            check_hresult(encoder->CreateNewFrame(frame_encode.put(), property_bag.put()));
+
+            VARIANT value{};
+            value.vt = VT_UI2;
+            value.uiVal = 16;
+            PROPBAG2 option{};
+            option.pstrName = const_cast<LPOLESTR>(encoder_option_name::restart_interval);
+            check_hresult(property_bag->Write(1, &option, &value));
+
+            check_hresult(frame_encode->Initialize(property_bag.get()));
+            check_hresult(frame_encode->SetSize(width, height));
+            GUID pixel_format{GUID_WICPixelFormat8bppGray};
+            check_hresult(frame_encode->SetPixelFormat(&pixel_format));
+            check_hresult(frame_encode->WritePixels(height, width, static_cast<uint32_t>(pixels.size()),
+                                                    reinterpret_cast<BYTE*>(pixels.data())));
+            check_hresult(frame_encode->Commit());
+            check_hresult(encoder->Commit());
+        }
+
+        check_hresult(IStream_Reset(stream.get()));
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(stream.get(), WICDecodeMetadataCacheOnDemand)};
+
+        constexpr int32_t strip_height{100};
+        vector<std::byte> strip(static_cast<size_t>(width) * strip_height);
+        for (int32_t y{}; y < static_cast<int32_t>(height); y += strip_height)
+        {
+            const WICRect rectangle{0, y, static_cast<int32_t>(width),
+                                    std::min(strip_height, static_cast<int32_t>(height) - y)};
+            const auto strip_size{static_cast<size_t>(width) * rectangle.Height};
+            check_hresult(bitmap_frame_decoder->CopyPixels(&rectangle, width, static_cast<uint32_t>(strip_size),
+                                                           reinterpret_cast<BYTE*>(strip.data())));
+
+            Assert::IsTrue(std::equal(strip.begin(), strip.begin() + static_cast<std::ptrdiff_t>(strip_size),
+                                      pixels.begin() + (static_cast<std::ptrdiff_t>(width) * y)));
+        }
+    }
+
+    TEST_METHOD(CopyPixels_strips_on_demand_decodes_once) // NOLINT
+    {
+        // Without restart intervals the image is decoded once: reading it strip by strip costs about one full decode.
+        constexpr uint32_t width{4096};
+        constexpr uint32_t height{2048};
+        vector<std::byte> pixels(static_cast<size_t>(width) * height);
+        for (size_t i{}; i != pixels.size(); ++i)
+        {
+            pixels[i] = static_cast<std::byte>(((i % width) * 3) ^ (i / width));
+        }
+        const auto encoded{charls::jpegls_encoder::encode(
+            pixels, {.width = width, .height = height, .bits_per_sample = 8, .component_count = 1})};
+
+        vector<std::byte> buffer(pixels.size());
+        const auto full_start{std::chrono::steady_clock::now()};
+        check_hresult(copy_pixels<std::byte>(*create_frame_decoder(encoded), width, buffer));
+        const auto full_duration{std::chrono::steady_clock::now() - full_start};
+
+        const com_ptr bitmap_frame_decoder{create_frame_decoder(encoded)};
+        constexpr int32_t strip_height{64};
+        const auto strips_start{std::chrono::steady_clock::now()};
+        for (int32_t y{}; y != static_cast<int32_t>(height); y += strip_height)
+        {
+            const WICRect rectangle{0, y, static_cast<int32_t>(width), strip_height};
+            check_hresult(bitmap_frame_decoder->CopyPixels(
+                &rectangle, width, width * strip_height,
+                reinterpret_cast<BYTE*>(buffer.data() + (static_cast<size_t>(width) * y))));
+        }
+        const auto strips_duration{std::chrono::steady_clock::now() - strips_start};
+
+        Assert::IsTrue(buffer == pixels);
+        Assert::IsTrue(strips_duration < full_duration * 4); // 32 strips: a decode per strip would be 32 times slower.
+    }
+
 private:
+    static void decode_and_compare(IWICBitmapFrameDecode& bitmap_frame_decoder,
+                                   _Null_terminated_ const char* filename_expected)
+    {
+        const auto [width, height]{get_size(bitmap_frame_decoder)};
+        vector<std::byte> buffer(static_cast<size_t>(width) * height);
+        check_hresult(copy_pixels<std::byte>(bitmap_frame_decoder, width, buffer));
+
+        compare(filename_expected, buffer);
+    }
+
+    [[nodiscard]]
+    static vector<std::byte> read_file(_Null_terminated_ const wchar_t* filename)
+    {
+        std::ifstream file;
+        file.exceptions(std::ios::eofbit | std::ios::failbit | std::ios::badbit);
+        file.open(filename, std::ios::in | std::ios::binary);
+
+        vector<std::byte> content(std::filesystem::file_size(filename));
+        file.read(reinterpret_cast<char*>(content.data()), static_cast<std::streamsize>(content.size()));
+        return content;
+    }
+
     void decode_2_bit_monochrome(_Null_terminated_ const wchar_t* filename_actual,
                                  _Null_terminated_ const char* filename_expected) const
     {
@@ -476,13 +717,20 @@ TEST_CLASS(jpegls_bitmap_frame_decode_test)
     }
 
     [[nodiscard]]
-    com_ptr<IWICBitmapFrameDecode> create_frame_decoder(_Null_terminated_ const wchar_t* filename) const
+    com_ptr<IWICBitmapFrameDecode> create_frame_decoder(_Null_terminated_ const wchar_t* filename,
+                                                        const WICDecodeOptions cache_options = WICDecodeMetadataCacheOnDemand) const
     {
         com_ptr<IStream> stream;
         check_hresult(SHCreateStreamOnFileEx(filename, STGM_READ | STGM_SHARE_DENY_WRITE, 0, false, nullptr, stream.put()));
 
+        return create_frame_decoder(stream.get(), cache_options);
+    }
+
+    [[nodiscard]]
+    com_ptr<IWICBitmapFrameDecode> create_frame_decoder(IStream* stream, const WICDecodeOptions cache_options) const
+    {
         const com_ptr wic_bitmap_decoder{com_factory_.create_decoder()};
-        check_hresult(wic_bitmap_decoder->Initialize(stream.get(), WICDecodeMetadataCacheOnDemand));
+        check_hresult(wic_bitmap_decoder->Initialize(stream, cache_options));
 
         com_ptr<IWICBitmapFrameDecode> bitmap_frame_decode;
         check_hresult(wic_bitmap_decoder->GetFrame(0, bitmap_frame_decode.put()));
@@ -8,6 +8,7 @@ import winrt_base;
 import <win.hpp>;
 
 import hresults;
+import size_estimation;
 
 import com_factory;
 import "macros.hpp";
@@ -139,9 +140,23 @@ TEST_CLASS(jpegls_bitmap_frame_encode_test)
         Assert::AreEqual(wincodec::error_unsupported_operation, result);
     }
 
-    TEST_METHOD(SetPalette_is_not_supported) // NOLINT
+    TEST_METHOD(SetPalette) // NOLINT
     {
         const com_ptr bitmap_frame_encoder{create_frame_encoder()};
+        check_hresult(bitmap_frame_encoder->Initialize(nullptr));
+
+        com_ptr<IWICPalette> palette;
+        check_hresult(imaging_factory()->CreatePalette(palette.put()));
+        check_hresult(palette->InitializePredefined(WICBitmapPaletteTypeFixedWebPalette, false));
+
+        const HRESULT result{bitmap_frame_encoder->SetPalette(palette.get())};
+        Assert::AreEqual(success_ok, result);
+    }
+
+    TEST_METHOD(SetPalette_uninitialized_palette) // NOLINT
+    {
+        const com_ptr bitmap_frame_encoder{create_frame_encoder()};
+        check_hresult(bitmap_frame_encoder->Initialize(nullptr));
 
         com_ptr<IWICPalette> palette;
         check_hresult(imaging_factory()->CreatePalette(palette.put()));
@@ -252,17 +267,101 @@ TEST_CLASS(jpegls_bitmap_frame_encode_test)
         Assert::AreEqual(wincodec::error_wrong_state, result);
     }
 
-    TEST_METHOD(Commit) // NOLINT
+    TEST_METHOD(Commit_missing_lines) // NOLINT
     {
         const com_ptr bitmap_frame_encoder{create_frame_encoder()};
         check_hresult(bitmap_frame_encoder->Initialize(nullptr));
         check_hresult(bitmap_frame_encoder->SetSize(512, 512));
         set_pixel_format(bitmap_frame_encoder.get(), GUID_WICPixelFormat8bppGray);
-        vector<uint8_t> source(512 * 512);
-        check_hresult(bitmap_frame_encoder->WritePixels(512, 512, static_cast<UINT>(source.size()), source.data()));
+        vector<uint8_t> source(512 * 256);
+        check_hresult(bitmap_frame_encoder->WritePixels(256, 512, static_cast<UINT>(source.size()), source.data()));
 
         const HRESULT result{bitmap_frame_encoder->Commit()};
-        Assert::AreEqual(success_ok, result); // TODO: commit should fail.
+        Assert::AreEqual(wincodec::error_wrong_state, result);
+    }
+
+    TEST_METHOD(EstimateSize) // NOLINT
+    {
+        constexpr uint32_t width{512};
+        constexpr uint32_t height{512};
+        vector<uint8_t> source(static_cast<size_t>(width) * height);
+        uint32_t random{1};
+        for (size_t i{}; i != source.size(); ++i)
+        {
+            random = (random * 1664525) + 1013904223;
+            source[i] = static_cast<uint8_t>((i % width) + (i / width) + (random >> 29));
+        }
+
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        const com_ptr encoder{com_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+        com_ptr<IWICBitmapFrameEncode> bitmap_frame_encoder;
+        check_hresult(encoder->CreateNewFrame(bitmap_frame_encoder.put(), nullptr));
+        check_hresult(bitmap_frame_encoder->Initialize(nullptr));
+        check_hresult(bitmap_frame_encoder->SetSize(width, height));
+        set_pixel_format(bitmap_frame_encoder.get(), GUID_WICPixelFormat8bppGray);
+        check_hresult(bitmap_frame_encoder->WritePixels(height, width, static_cast<UINT>(source.size()), source.data()));
+
+        ULONGLONG estimated_size;
+        ULONGLONG error_bound;
+        const HRESULT result{
+            bitmap_frame_encoder.as<IJpegLsSizeEstimation>()->EstimateSize(&estimated_size, &error_bound)};
+        Assert::AreEqual(success_ok, result);
+
+        check_hresult(bitmap_frame_encoder->Commit());
+        check_hresult(encoder->Commit());
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+
+        // The headers are counted once, the sampled lines determine the error.
+        const auto actual_size{static_cast<int64_t>(stat.cbSize.QuadPart)};
+        const int64_t difference{static_cast<int64_t>(estimated_size) - actual_size};
+        Assert::IsTrue(std::abs(difference) <= static_cast<int64_t>(error_bound) + (actual_size / 20));
+    }
+
+    TEST_METHOD(EstimateSize_small_image_is_exact) // NOLINT
+    {
+        com_ptr<IStream> stream;
+        stream.attach(SHCreateMemStream(nullptr, 0));
+        const com_ptr encoder{com_factory_.create_encoder()};
+        check_hresult(encoder->Initialize(stream.get(), WICBitmapEncoderCacheInMemory));
+        com_ptr<IWICBitmapFrameEncode> bitmap_frame_encoder;
+        check_hresult(encoder->CreateNewFrame(bitmap_frame_encoder.put(), nullptr));
+        check_hresult(bitmap_frame_encoder->Initialize(nullptr));
+        check_hresult(bitmap_frame_encoder->SetSize(512, 64));
+        set_pixel_format(bitmap_frame_encoder.get(), GUID_WICPixelFormat8bppGray);
+        vector<uint8_t> source(512 * 64);
+        check_hresult(bitmap_frame_encoder->WritePixels(64, 512, static_cast<UINT>(source.size()), source.data()));
+
+        ULONGLONG estimated_size;
+        ULONGLONG error_bound;
+        const HRESULT result{
+            bitmap_frame_encoder.as<IJpegLsSizeEstimation>()->EstimateSize(&estimated_size, &error_bound)};
+        Assert::AreEqual(success_ok, result);
+        Assert::AreEqual(0ULL, error_bound);
+
+        check_hresult(bitmap_frame_encoder->Commit());
+        check_hresult(encoder->Commit());
+        STATSTG stat;
+        check_hresult(stream->Stat(&stat, STATFLAG_NONAME));
+        Assert::AreEqual(static_cast<ULONGLONG>(stat.cbSize.QuadPart), estimated_size);
+    }
+
+    TEST_METHOD(EstimateSize_missing_lines) // NOLINT
+    {
+        const com_ptr bitmap_frame_encoder{create_frame_encoder()};
+        check_hresult(bitmap_frame_encoder->Initialize(nullptr));
+        check_hresult(bitmap_frame_encoder->SetSize(512, 512));
+        set_pixel_format(bitmap_frame_encoder.get(), GUID_WICPixelFormat8bppGray);
+        vector<uint8_t> source(512 * 256);
+        check_hresult(bitmap_frame_encoder->WritePixels(256, 512, static_cast<UINT>(source.size()), source.data()));
+
+        ULONGLONG estimated_size;
+        ULONGLONG error_bound;
+        const HRESULT result{
+            bitmap_frame_encoder.as<IJpegLsSizeEstimation>()->EstimateSize(&estimated_size, &error_bound)};
+        Assert::AreEqual(wincodec::error_wrong_state, result);
     }
 
 private:
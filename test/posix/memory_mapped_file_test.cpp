@@ -0,0 +1,65 @@
+// SPDX-FileCopyrightText: © 2026 Team CharLS
+// SPDX-License-Identifier: BSD-3-Clause
+
+// Builds and checks the POSIX (mmap) implementation of memory_mapped_file, which the Windows test project can't
+// compile. The mapping layer can then be benchmarked outside Windows.
+
+import std;
+
+import memory_mapped_file;
+
+namespace {
+
+int failure_count{};
+
+void check(const bool condition, const std::string_view description)
+{
+    if (!condition)
+    {
+        std::println(std::cerr, "failed: {}", description);
+        ++failure_count;
+    }
+}
+
+void write_file(const std::filesystem::path& path, const std::span<const std::byte> bytes)
+{
+    std::ofstream output{path, std::ios::binary | std::ios::trunc};
+    output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+} // namespace
+
+int main()
+{
+    const std::filesystem::path directory{std::filesystem::temp_directory_path()};
+
+    const std::filesystem::path path{directory / "memory_mapped_file_test.bin"};
+    std::vector<std::byte> bytes(100'000);
+    for (std::size_t i{}; i != bytes.size(); ++i)
+    {
+        bytes[i] = static_cast<std::byte>((i * 7) ^ (i >> 8));
+    }
+    write_file(path, bytes);
+
+    {
+        auto mapped_file{memory_mapped_file::open(path)};
+        check(mapped_file.has_value(), "open existing file");
+        check(mapped_file && std::ranges::equal(mapped_file->bytes(), bytes), "mapped bytes equal file content");
+
+        // A moved-from mapping is empty: only the new owner unmaps the view.
+        if (mapped_file)
+        {
+            const auto moved{std::move(*mapped_file)};
+            check(mapped_file->bytes().empty() && moved.bytes().size() == bytes.size(), "move transfers the view");
+        }
+    }
+
+    const std::filesystem::path empty_path{directory / "memory_mapped_file_test_empty.bin"};
+    write_file(empty_path, {});
+    check(!memory_mapped_file::open(empty_path), "empty file can't be mapped");
+    check(!memory_mapped_file::open(directory / "memory_mapped_file_test_missing.bin"), "missing file");
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(empty_path);
+    return failure_count == 0 ? 0 : 1;
+}
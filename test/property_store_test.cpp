@@ -10,11 +10,13 @@ import <win.hpp>;
 import hresults;
 
 import com_factory;
+import test_stream;
 import test.util;
 import "macros.hpp";
 
 using std::span;
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using winrt::check_hresult;
 using winrt::com_ptr;
 
 TEST_CLASS(property_store_test)
@@ -160,6 +162,49 @@ TEST_CLASS(property_store_test)
         std::ignore = PropVariantClear(&prop_variant);
     }
 
+    TEST_METHOD(Initialize_after_decoder_query_capability) // NOLINT
+    {
+        const auto stream{create_stream_on_file(L"tulips-gray-8bit-512-512.jls")};
+        DWORD capability;
+        check_hresult(com_factory_.create_decoder()->QueryCapability(stream.get(), &capability));
+
+        // The second initialization of the same file can use the cached header information.
+        const auto property_store{com_factory_.create_property_store()};
+        auto result{property_store.as<IInitializeWithStream>()->Initialize(stream.get(), STGM_READ)};
+        Assert::AreEqual(success_ok, result);
+
+        PROPVARIANT prop_variant;
+        PropVariantInit(&prop_variant);
+        result = property_store->GetValue(PKEY_Image_VerticalSize, &prop_variant);
+        Assert::AreEqual(success_ok, result);
+        Assert::IsTrue(VT_UI4 == prop_variant.vt);
+        Assert::AreEqual(512U, prop_variant.uintVal);
+        std::ignore = PropVariantClear(&prop_variant);
+    }
+
+    TEST_METHOD(Initialize_uses_cached_header_information) // NOLINT
+    {
+        constexpr const wchar_t* name{L"property-store-header-cache.jls"};
+        const com_ptr<IStream> unlimited_stream{winrt::make<read_limited_stream>(
+            create_stream_on_file(L"tulips-gray-8bit-512-512.jls"), name, std::numeric_limits<std::uint64_t>::max())};
+        DWORD capability;
+        check_hresult(com_factory_.create_decoder()->QueryCapability(unlimited_stream.get(), &capability));
+
+        // Without a cache hit the property store would read the complete stream, which fails after 4 KiB.
+        const com_ptr<IStream> stream{
+            winrt::make<read_limited_stream>(create_stream_on_file(L"tulips-gray-8bit-512-512.jls"), name, 4096)};
+        const auto property_store{com_factory_.create_property_store()};
+        auto result{property_store.as<IInitializeWithStream>()->Initialize(stream.get(), STGM_READ)};
+        Assert::AreEqual(success_ok, result);
+
+        PROPVARIANT prop_variant;
+        PropVariantInit(&prop_variant);
+        result = property_store->GetValue(PKEY_Image_VerticalSize, &prop_variant);
+        Assert::AreEqual(success_ok, result);
+        Assert::AreEqual(512U, prop_variant.uintVal);
+        std::ignore = PropVariantClear(&prop_variant);
+    }
+
     TEST_METHOD(GetAt)
     {
         const auto property_store{com_factory_.create_property_store()};
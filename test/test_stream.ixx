@@ -7,10 +7,12 @@ module;
 
 export module test_stream;
 
+import std;
 import winrt_base;
 import <win.hpp>;
 
 import hresults;
+import stream_memory;
 
 
 export struct test_stream : winrt::implements<test_stream, IStream>
@@ -95,3 +97,222 @@ private:
     bool fail_on_read_;
     int fail_on_seek_counter_;
 };
+
+// Stand-in for a memory-backed stream: the content can only be accessed by IStreamMemoryAccess, Read always fails.
+export struct memory_access_stream : winrt::implements<memory_access_stream, IStream, IStreamMemoryAccess>
+{
+    explicit memory_access_stream(std::vector<std::byte> content) noexcept : content_{std::move(content)}
+    {
+    }
+
+    HRESULT __stdcall GetMemory(_Outptr_result_bytebuffer_(*size) const BYTE** memory,
+                                _Out_ ULONGLONG* size) noexcept override
+    {
+        *memory = reinterpret_cast<const BYTE*>(content_.data());
+        *size = content_.size();
+        return success_ok;
+    }
+
+    HRESULT __stdcall Read(_Out_writes_bytes_to_(cb, *pcbRead) void* /*pv*/, _In_ ULONG /*cb*/,
+                           _Out_opt_ ULONG* pcbRead) noexcept override
+    {
+        if (pcbRead)
+        {
+            *pcbRead = 0;
+        }
+
+        return error_fail;
+    }
+
+    HRESULT __stdcall Write(_In_reads_bytes_(cb) const void* /*pv*/, _In_ ULONG /*cb*/,
+                            _Out_opt_ ULONG* /*pcbWritten*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall Seek(const LARGE_INTEGER move, const DWORD origin,
+                           _Out_opt_ ULARGE_INTEGER* new_position) noexcept override
+    {
+        std::int64_t position;
+        switch (origin)
+        {
+        case STREAM_SEEK_SET:
+            position = move.QuadPart;
+            break;
+        case STREAM_SEEK_CUR:
+            position = static_cast<std::int64_t>(position_) + move.QuadPart;
+            break;
+        case STREAM_SEEK_END:
+            position = static_cast<std::int64_t>(content_.size()) + move.QuadPart;
+            break;
+        default:
+            return error_invalid_argument;
+        }
+
+        if (position < 0)
+            return error_invalid_argument;
+
+        position_ = static_cast<std::uint64_t>(position);
+        if (new_position)
+        {
+            new_position->QuadPart = position_;
+        }
+
+        return success_ok;
+    }
+
+    HRESULT __stdcall SetSize(ULARGE_INTEGER /*libNewSize*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall CopyTo(_In_ IStream*, ULARGE_INTEGER /*cb*/, _Out_opt_ ULARGE_INTEGER* /*pcbRead*/,
+                             _Out_opt_ ULARGE_INTEGER* /*pcbWritten*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall Commit(DWORD /*grfCommitFlags*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall Revert() noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall LockRegion(ULARGE_INTEGER /*libOffset*/, ULARGE_INTEGER /*cb*/, DWORD /*dwLockType*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall UnlockRegion(ULARGE_INTEGER /*libOffset*/, ULARGE_INTEGER /*cb*/,
+                                   DWORD /*dwLockType*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall Stat(__RPC__out STATSTG* statstg, DWORD /*grfStatFlag*/) noexcept override
+    {
+        *statstg = {};
+        statstg->type = STGTY_STREAM;
+        statstg->cbSize.QuadPart = content_.size();
+        return success_ok;
+    }
+
+    HRESULT __stdcall Clone(__RPC__deref_out_opt IStream**) noexcept override
+    {
+        return error_fail;
+    }
+
+private:
+    std::vector<std::byte> content_;
+    std::uint64_t position_{};
+};
+
+// Forwards to a stream, but reports a relative name (a stream identity that can't be memory mapped) and fails reads
+// once more than read_limit bytes would have been read.
+export struct read_limited_stream : winrt::implements<read_limited_stream, IStream>
+{
+    read_limited_stream(winrt::com_ptr<IStream> stream, std::wstring name, const std::uint64_t read_limit) :
+        stream_{std::move(stream)}, name_{std::move(name)}, read_limit_{read_limit}
+    {
+    }
+
+    HRESULT __stdcall Read(_Out_writes_bytes_to_(cb, *pcbRead) void* pv, _In_ const ULONG cb,
+                           _Out_opt_ ULONG* pcbRead) noexcept override
+    {
+        if (cb > read_limit_ - read_byte_count_)
+        {
+            if (pcbRead)
+            {
+                *pcbRead = 0;
+            }
+
+            return error_fail;
+        }
+
+        ULONG read;
+        const HRESULT result{stream_->Read(pv, cb, &read)};
+        read_byte_count_ += read;
+        if (pcbRead)
+        {
+            *pcbRead = read;
+        }
+
+        return result;
+    }
+
+    HRESULT __stdcall Write(_In_reads_bytes_(cb) const void* /*pv*/, _In_ ULONG /*cb*/,
+                            _Out_opt_ ULONG* /*pcbWritten*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall Seek(const LARGE_INTEGER move, const DWORD origin,
+                           _Out_opt_ ULARGE_INTEGER* new_position) noexcept override
+    {
+        return stream_->Seek(move, origin, new_position);
+    }
+
+    HRESULT __stdcall SetSize(ULARGE_INTEGER /*libNewSize*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall CopyTo(_In_ IStream*, ULARGE_INTEGER /*cb*/, _Out_opt_ ULARGE_INTEGER* /*pcbRead*/,
+                             _Out_opt_ ULARGE_INTEGER* /*pcbWritten*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall Commit(DWORD /*grfCommitFlags*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall Revert() noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall LockRegion(ULARGE_INTEGER /*libOffset*/, ULARGE_INTEGER /*cb*/, DWORD /*dwLockType*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall UnlockRegion(ULARGE_INTEGER /*libOffset*/, ULARGE_INTEGER /*cb*/,
+                                   DWORD /*dwLockType*/) noexcept override
+    {
+        return error_fail;
+    }
+
+    HRESULT __stdcall Stat(__RPC__out STATSTG* statstg, const DWORD grfStatFlag) noexcept override
+    {
+        if (const HRESULT result{stream_->Stat(statstg, STATFLAG_NONAME)}; FAILED(result))
+            return result;
+
+        if (grfStatFlag == STATFLAG_NONAME)
+            return success_ok;
+
+        const size_t size{(name_.size() + 1) * sizeof(wchar_t)};
+        statstg->pwcsName = static_cast<wchar_t*>(CoTaskMemAlloc(size));
+        if (!statstg->pwcsName)
+            return error_out_of_memory;
+
+        std::memcpy(statstg->pwcsName, name_.c_str(), size);
+        return success_ok;
+    }
+
+    HRESULT __stdcall Clone(__RPC__deref_out_opt IStream**) noexcept override
+    {
+        return error_fail;
+    }
+
+private:
+    winrt::com_ptr<IStream> stream_;
+    std::wstring name_;
+    std::uint64_t read_limit_;
+    std::uint64_t read_byte_count_{};
+};